@@ -0,0 +1,243 @@
+/* Throughput benchmark of the input path: synthetic streams are written into
+ * a pipe and read back through the real record parser, exactly like
+ * app_run() does once poll() reports the pipe readable. Rendering is left
+ * out; every record is only checked for valid UTF-8, as pane_set_text() does.
+ *
+ * Allocations are counted by wrapping malloc() at link time.
+ */
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/ioctl.h>
+
+#include"wayout.h"
+#include"input.h"
+#include"misc.h"
+#include"utf8.h"
+
+#define STREAM_SIZE (32 << 20)
+
+static uint64_t allocations;
+
+void *__real_malloc (size_t size);
+void *__real_calloc (size_t count, size_t size);
+void *__real_realloc (void *ptr, size_t size);
+
+void *__wrap_malloc (size_t size)
+{
+	allocations++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc (size_t count, size_t size)
+{
+	allocations++;
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc (void *ptr, size_t size)
+{
+	allocations++;
+	return __real_realloc(ptr, size);
+}
+
+struct Stream
+{
+	const char *name;
+	bool        framed;
+	char       *delimiter;
+	bool        feed;
+
+	/* Size of every write() into the pipe. */
+	size_t      burst;
+
+	/* Fills the buffer, returns the number of bytes used. */
+	size_t (*generate) (char *buffer, size_t size);
+};
+
+struct Result
+{
+	uint64_t records;
+	uint64_t bytes;
+	uint64_t clean;
+};
+
+static size_t generate_tiny_lines (char *buffer, size_t size)
+{
+	size_t len = 0;
+	for (uint32_t i = 0; len + 16 < size; i++)
+		len += (size_t)sprintf(buffer + len, "%u%%\n", i % 100);
+	return len;
+}
+
+static size_t generate_paragraphs (char *buffer, size_t size)
+{
+	size_t len = 0;
+	while ( len + 4096 + 2 < size )
+	{
+		/* 4 KiB of 64 byte lines, followed by an empty line. */
+		for (int line = 0; line < 64; line++)
+		{
+			memset(buffer + len, 'a' + line % 26, 63);
+			buffer[len+63] = '\n';
+			len += 64;
+		}
+		buffer[len++] = '\n';
+	}
+	return len;
+}
+
+static size_t generate_delimited (char *buffer, size_t size)
+{
+	static const char line[]      = "CPU 12% \xe2\x96\x81\xe2\x96\x83\xe2\x96\x85\n";
+	static const char delimiter[] = "\xe2\x80\x94\xe2\x80\x94\n";
+	size_t len = 0;
+	while ( len + 4 * sizeof(line) + sizeof(delimiter) < size )
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			memcpy(buffer + len, line, sizeof(line) - 1);
+			len += sizeof(line) - 1;
+		}
+		memcpy(buffer + len, delimiter, sizeof(delimiter) - 1);
+		len += sizeof(delimiter) - 1;
+	}
+	return len;
+}
+
+static size_t generate_no_delimiter (char *buffer, size_t size)
+{
+	memset(buffer, 'x', size);
+	buffer[size-1] = '\n';
+	return size;
+}
+
+static void handle_record (void *data, const char *record, size_t len)
+{
+	struct Result *result = (struct Result *)data;
+	result->records++;
+	result->bytes += len;
+	if ( utf8_clean_prefix(record, len) == len )
+		result->clean++;
+}
+
+/* Writes the stream into the pipe in bursts and reads everything back
+ * after each burst, timing every single read as one wakeup.
+ */
+static bool run_stream (struct App *app, struct Stream *stream, char *data, size_t size)
+{
+	int pipefd[2];
+	if ( pipe(pipefd) == -1 )
+	{
+		printlog(NULL, 0, "ERROR: pipe: %s\n", strerror(errno));
+		return false;
+	}
+	fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+	fcntl(pipefd[1], F_SETFL, O_NONBLOCK);
+	fcntl(pipefd[1], F_SETPIPE_SZ, 1 << 20);
+
+	struct Input *input = calloc(1, sizeof(struct Input));
+	if ( input == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return false;
+	}
+	init_input(input, app, pipefd[0]);
+	input->feed      = stream->feed;
+	input->delimiter = stream->delimiter;
+	input->framed    = stream->framed;
+
+	struct Result result = { 0 };
+	uint64_t wakeups = 0, worst = 0;
+	uint64_t allocations_before = allocations;
+	uint64_t dropped_before = app->stats.records_dropped;
+	uint64_t start = monotonic_ns();
+
+	for (size_t offset = 0; offset < size; )
+	{
+		size_t burst = size - offset < stream->burst ? size - offset : stream->burst;
+		ssize_t ret = write(pipefd[1], data + offset, burst);
+		if ( ret < 0 && errno != EAGAIN )
+		{
+			printlog(NULL, 0, "ERROR: write: %s\n", strerror(errno));
+			break;
+		}
+		if ( ret > 0 )
+			offset += (size_t)ret;
+
+		int pending;
+		while ( ioctl(pipefd[0], FIONREAD, &pending) == 0 && pending > 0 )
+		{
+			uint64_t wakeup = monotonic_ns();
+			input_read(input, handle_record, &result);
+			wakeup = monotonic_ns() - wakeup;
+			if ( wakeup > worst )
+				worst = wakeup;
+			wakeups++;
+		}
+	}
+
+	/* EOF flushes the last record. */
+	close(pipefd[1]);
+	while (input_read(input, handle_record, &result))
+		wakeups++;
+
+	double seconds = (double)(monotonic_ns() - start) / 1000000000.0;
+	printf("%-14s records/s=%-10.0f MB/s=%-8.1f allocs/record=%-6.3f "
+			"max_wakeup_us=%-8.1f wakeups=%lu dropped=%lu\n",
+			stream->name,
+			(double)result.records / seconds,
+			(double)size / seconds / 1000000.0,
+			result.records > 0 ? (double)(allocations - allocations_before)
+				/ (double)result.records : 0.0,
+			(double)worst / 1000.0,
+			(unsigned long)wakeups,
+			(unsigned long)(app->stats.records_dropped - dropped_before));
+
+	finish_input(input);
+	close(pipefd[0]);
+	free(input);
+	return true;
+}
+
+int main (int argc, char *argv[])
+{
+	struct Stream streams[] = {
+		{ "tiny-lines",   false, NULL,   true, 4096,    generate_tiny_lines   },
+		{ "tiny-burst",   false, NULL,   true, 1 << 20, generate_tiny_lines   },
+		{ "paragraphs",   false, "\n",   true, 65536,   generate_paragraphs   },
+		{ "delimiter",    false, "\xe2\x80\x94\xe2\x80\x94\n", true, 65536,
+			generate_delimited },
+		{ "no-delimiter", false, NULL,   true, 65536,   generate_no_delimiter },
+	};
+
+	struct App app = { 0 };
+
+	char *data = malloc(STREAM_SIZE);
+	if ( data == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < sizeof(streams) / sizeof(streams[0]); i++)
+	{
+		if ( argc > 1 && strcmp(argv[1], streams[i].name) )
+			continue;
+		size_t size = streams[i].generate(data, STREAM_SIZE);
+		if (! run_stream(&app, &streams[i], data, size))
+		{
+			free(data);
+			return EXIT_FAILURE;
+		}
+	}
+
+	free(data);
+	return EXIT_SUCCESS;
+}
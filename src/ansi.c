@@ -0,0 +1,272 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+
+#include<pango/pangocairo.h>
+
+#include"colour.h"
+#include"utf8.h"
+#include"ansi.h"
+
+#define ESC 0x1b
+#define BEL 0x07
+
+/* Parameters beyond this are ignored. */
+#define SGR_PARAMS_MAX 32
+
+/* The graphic rendition in effect, and where in the output it started. */
+struct Ansi_state
+{
+	struct Draw_colour foreground, background;
+	bool has_foreground, has_background;
+	bool bold, faint, italic, underline, inverse, strikethrough;
+	size_t start;
+};
+
+static void insert (PangoAttrList *attrs, PangoAttribute *attr, size_t start, size_t end)
+{
+	attr->start_index = (guint)start;
+	attr->end_index   = (guint)end;
+	pango_attr_list_insert(attrs, attr);
+}
+
+static guint16 channel (double value)
+{
+	return (guint16)(value * 65535.0 + 0.5);
+}
+
+/* Adds the attributes of the run from state->start to end. */
+static void close_run (PangoAttrList *attrs, struct Ansi_state *state, size_t end,
+		const struct Draw_colour *default_foreground,
+		const struct Draw_colour *default_background)
+{
+	if ( end <= state->start )
+		return;
+
+	const struct Draw_colour *fg = state->has_foreground ? &state->foreground : NULL;
+	const struct Draw_colour *bg = state->has_background ? &state->background : NULL;
+	if (state->inverse)
+	{
+		const struct Draw_colour *tmp = fg;
+		fg = bg != NULL ? bg : default_background;
+		bg = tmp != NULL ? tmp : default_foreground;
+	}
+
+	if ( fg != NULL )
+		insert(attrs, pango_attr_foreground_new(channel(fg->r), channel(fg->g),
+					channel(fg->b)), state->start, end);
+	if ( bg != NULL )
+		insert(attrs, pango_attr_background_new(channel(bg->r), channel(bg->g),
+					channel(bg->b)), state->start, end);
+	if ( state->bold || state->faint )
+		insert(attrs, pango_attr_weight_new(state->bold ? PANGO_WEIGHT_BOLD
+					: PANGO_WEIGHT_LIGHT), state->start, end);
+	if (state->italic)
+		insert(attrs, pango_attr_style_new(PANGO_STYLE_ITALIC), state->start, end);
+	if (state->underline)
+		insert(attrs, pango_attr_underline_new(PANGO_UNDERLINE_SINGLE),
+				state->start, end);
+	if (state->strikethrough)
+		insert(attrs, pango_attr_strikethrough_new(true), state->start, end);
+}
+
+/* Handles an extended colour, "5;n" or "2;r;g;b" after 38 or 48. Returns the
+ * number of parameters used.
+ */
+static size_t extended_colour (struct Draw_colour *colour, bool *has,
+		const int *params, size_t count)
+{
+	if ( count >= 2 && params[0] == 5 )
+	{
+		colour_from_ansi_index(colour, (uint8_t)params[1]);
+		*has = true;
+		return 2;
+	}
+	if ( count >= 4 && params[0] == 2 )
+	{
+		colour->r = (double)(params[1] & 0xff) / 255.0;
+		colour->g = (double)(params[2] & 0xff) / 255.0;
+		colour->b = (double)(params[3] & 0xff) / 255.0;
+		colour->a = 1.0;
+		*has = true;
+		return 4;
+	}
+	return count;
+}
+
+static void apply_sgr (struct Ansi_state *state, const int *params, size_t count)
+{
+	if ( count == 0 )
+	{
+		static const int reset = 0;
+		params = &reset;
+		count = 1;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		int p = params[i];
+		if ( p == 0 )
+		{
+			size_t start = state->start;
+			memset(state, 0, sizeof(struct Ansi_state));
+			state->start = start;
+		}
+		else if ( p == 1 )
+			state->bold = true;
+		else if ( p == 2 )
+			state->faint = true;
+		else if ( p == 3 )
+			state->italic = true;
+		else if ( p == 4 )
+			state->underline = true;
+		else if ( p == 7 )
+			state->inverse = true;
+		else if ( p == 9 )
+			state->strikethrough = true;
+		else if ( p == 22 )
+			state->bold = state->faint = false;
+		else if ( p == 23 )
+			state->italic = false;
+		else if ( p == 24 )
+			state->underline = false;
+		else if ( p == 27 )
+			state->inverse = false;
+		else if ( p == 29 )
+			state->strikethrough = false;
+		else if ( p >= 30 && p <= 37 )
+		{
+			colour_from_ansi_index(&state->foreground, (uint8_t)(p - 30));
+			state->has_foreground = true;
+		}
+		else if ( p >= 90 && p <= 97 )
+		{
+			colour_from_ansi_index(&state->foreground, (uint8_t)(p - 90 + 8));
+			state->has_foreground = true;
+		}
+		else if ( p >= 40 && p <= 47 )
+		{
+			colour_from_ansi_index(&state->background, (uint8_t)(p - 40));
+			state->has_background = true;
+		}
+		else if ( p >= 100 && p <= 107 )
+		{
+			colour_from_ansi_index(&state->background, (uint8_t)(p - 100 + 8));
+			state->has_background = true;
+		}
+		else if ( p == 38 )
+			i += extended_colour(&state->foreground, &state->has_foreground,
+					params + i + 1, count - i - 1);
+		else if ( p == 48 )
+			i += extended_colour(&state->background, &state->has_background,
+					params + i + 1, count - i - 1);
+		else if ( p == 39 )
+			state->has_foreground = false;
+		else if ( p == 49 )
+			state->has_background = false;
+	}
+}
+
+/* Skips the escape sequence starting at in[i], which is ESC. Returns the
+ * index after it. SGR sequences ("ESC [ ... m") are parsed into params,
+ * for all others count is left at SIZE_MAX.
+ */
+static size_t skip_escape (const char *in, size_t len, size_t i,
+		int params[static SGR_PARAMS_MAX], size_t *count)
+{
+	*count = SIZE_MAX;
+	if ( ++i >= len )
+		return i;
+
+	if ( in[i] == '[' )
+	{
+		/* CSI: parameters, intermediates, a final byte in 0x40-0x7e. */
+		size_t n = 0;
+		int value = 0;
+		bool digits = false;
+		for (i++; i < len; i++)
+		{
+			char c = in[i];
+			if ( c >= '0' && c <= '9' )
+			{
+				if ( value < 100000 )
+					value = value * 10 + (c - '0');
+				digits = true;
+			}
+			else if ( c == ';' || c == ':' )
+			{
+				if ( n < SGR_PARAMS_MAX )
+					params[n++] = value;
+				value  = 0;
+				digits = false;
+			}
+			else if ( c >= 0x40 && c <= 0x7e )
+			{
+				if ( c == 'm' )
+				{
+					if ( ( digits || n > 0 ) && n < SGR_PARAMS_MAX )
+						params[n++] = value;
+					*count = n;
+				}
+				return i + 1;
+			}
+			else if ( c < 0x20 || c > 0x3f )
+				return i; /* Malformed, resume at this byte. */
+		}
+		return i;
+	}
+
+	if ( in[i] == ']' || in[i] == 'P' || in[i] == '_' || in[i] == '^' )
+	{
+		/* OSC and other strings, terminated by BEL or ESC \. */
+		for (i++; i < len; i++)
+		{
+			if ( in[i] == BEL )
+				return i + 1;
+			if ( in[i] == ESC && i + 1 < len && in[i+1] == '\\' )
+				return i + 2;
+		}
+		return i;
+	}
+
+	/* Two byte sequences, possibly with intermediate bytes. */
+	while ( i < len && in[i] >= 0x20 && in[i] <= 0x2f )
+		i++;
+	return i < len ? i + 1 : i;
+}
+
+/* Strips all escape sequences from the text, turning the SGR ones into
+ * attributes, and sanitises the rest like utf8_sanitise(), all in a single
+ * pass. The attribute indices refer to out, which must have room for
+ * len * UTF8_SANITISE_FACTOR bytes. Inverse video without explicit colours
+ * uses the given defaults. Returns the length of out.
+ */
+size_t ansi_parse (char *out, PangoAttrList *attrs, const char *in, size_t len,
+		const struct Draw_colour *foreground, const struct Draw_colour *background)
+{
+	struct Ansi_state state = { 0 };
+	int params[SGR_PARAMS_MAX];
+	size_t out_len = 0;
+
+	for (size_t i = 0; i < len; )
+	{
+		const char *esc = memchr(in + i, ESC, len - i);
+		size_t end = esc == NULL ? len : (size_t)(esc - in);
+		if ( end > i )
+			out_len += utf8_sanitise(out + out_len, in + i, end - i);
+		if ( esc == NULL )
+			break;
+
+		size_t count;
+		i = skip_escape(in, len, end, params, &count);
+		if ( count == SIZE_MAX )
+			continue;
+
+		close_run(attrs, &state, out_len, foreground, background);
+		apply_sgr(&state, params, count);
+		state.start = out_len;
+	}
+
+	close_run(attrs, &state, out_len, foreground, background);
+	return out_len;
+}
@@ -0,0 +1,12 @@
+#ifndef WLCLOCK_ANSI_H
+#define WLCLOCK_ANSI_H
+
+#include<stddef.h>
+#include<pango/pangocairo.h>
+
+#include"colour.h"
+
+size_t ansi_parse (char *out, PangoAttrList *attrs, const char *in, size_t len,
+		const struct Draw_colour *foreground, const struct Draw_colour *background);
+
+#endif
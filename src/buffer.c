@@ -82,6 +82,8 @@ static void buffer_handle_release (void *data, struct wl_buffer *wl_buffer)
 {
 	struct Draw_buffer *buffer = (struct Draw_buffer *)data;
 	buffer->busy                  = false;
+	if ( buffer->release != NULL )
+		buffer->release(buffer->release_data);
 }
 
 static const struct wl_buffer_listener buffer_listener = {
@@ -153,8 +155,12 @@ void finish_buffer (struct Draw_buffer *buffer)
 	memset(buffer, 0, sizeof(struct Draw_buffer));
 }
 
+/* Picks a buffer which is not busy and makes sure it has the requested size.
+ * created, if not NULL, is incremented whenever a buffer had to be created.
+ */
 bool next_buffer (struct Draw_buffer **buffer, struct wl_shm *shm,
-		struct Draw_buffer buffers[static 2], uint32_t w, uint32_t h)
+		struct Draw_buffer buffers[static 2], uint32_t w, uint32_t h,
+		uint64_t *created)
 {
 	/* Check if buffers are busy and use first non-busy one, if it exists.
 	 * If all buffers are busy, exit.
@@ -178,6 +184,8 @@ bool next_buffer (struct Draw_buffer **buffer, struct wl_shm *shm,
 		finish_buffer(*buffer);
 		if (! create_buffer(shm, *buffer, w, h))
 			return false;
+		if ( created != NULL )
+			(*created)++;
 	}
 
 	return true;
@@ -16,10 +16,18 @@ struct Draw_buffer
 	void             *memory_object;
 	size_t            size;
 	bool              busy;
+
+	/* Value of app->seq the content of the buffer corresponds to. */
+	uint64_t          seq;
+
+	/* Called once the compositor released the buffer. */
+	void            (*release)(void *data);
+	void             *release_data;
 };
 
 bool next_buffer (struct Draw_buffer **buffer, struct wl_shm *shm,
-		struct Draw_buffer buffers[static 2], uint32_t w, uint32_t h);
+		struct Draw_buffer buffers[static 2], uint32_t w, uint32_t h,
+		uint64_t *created);
 void finish_buffer (struct Draw_buffer *buffer);
 
 #endif
@@ -0,0 +1,184 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/inotify.h>
+#include<sys/timerfd.h>
+
+#include"wayout.h"
+#include"misc.h"
+#include"clock.h"
+
+/* Returns the smallest unit in seconds which the strftime() format shows. */
+time_t format_resolution (const char *format)
+{
+	time_t resolution = 86400;
+	for (const char *c = format; *c != '\0'; c++)
+	{
+		if ( *c != '%' )
+			continue;
+		c++;
+		/* Skip the E and O modifiers. */
+		if ( *c == 'E' || *c == 'O' )
+			c++;
+		if ( *c == '\0' )
+			break;
+		if ( strchr("sSTrcX+", *c) != NULL )
+			return 1;
+		else if ( strchr("MR", *c) != NULL && resolution > 60 )
+			resolution = 60;
+		else if ( strchr("HIklpP", *c) != NULL && resolution > 3600 )
+			resolution = 3600;
+	}
+	return resolution;
+}
+
+/* Returns the next boundary of the unit after now. Hours and days are
+ * computed in local time, as time zones are not all offset by whole hours.
+ */
+time_t next_boundary (time_t now, time_t resolution)
+{
+	if ( resolution <= 60 )
+		return (now / resolution + 1) * resolution;
+
+	struct tm tm;
+	localtime_r(&now, &tm);
+	tm.tm_sec   = 0;
+	tm.tm_min   = 0;
+	tm.tm_isdst = -1;
+	if ( resolution == 3600 )
+		tm.tm_hour++;
+	else
+	{
+		tm.tm_hour = 0;
+		tm.tm_mday++;
+	}
+	return mktime(&tm);
+}
+
+static bool arm_clock (struct Clock *clock)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	/* The timer is cancelled if the real time clock is set, for example
+	 * by NTP or after a suspend, so the clock never shows a stale time.
+	 */
+	struct itimerspec timer_value = { 0 };
+	timer_value.it_value.tv_sec = next_boundary(now.tv_sec, clock->resolution);
+	if ( timerfd_settime(clock->fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+				&timer_value, NULL) == -1 )
+	{
+		printlog(NULL, 0, "ERROR: Unable to start timer.\n");
+		return false;
+	}
+	return true;
+}
+
+bool init_clock (struct Clock *clock, struct App *app, const char *format)
+{
+	clock->app        = app;
+	clock->format     = strdup(format);
+	clock->resolution = format_resolution(format);
+	if ( -1 == (clock->fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC)) )
+	{
+		printlog(NULL, 0, "ERROR: Unable to open timer fd.\n");
+		return false;
+	}
+	printlog(app, 1, "[clock] Format \"%s\": resolution=%lds\n",
+			format, (long)clock->resolution);
+	return arm_clock(clock);
+}
+
+/* Handles a timer expiration and re-arms the timer for the next boundary.
+ * Returns true if the time shown must be updated.
+ */
+bool clock_dispatch (struct Clock *clock)
+{
+	uint64_t expirations;
+	if ( read(clock->fd, &expirations, sizeof(expirations)) == -1 )
+	{
+		if ( errno != ECANCELED )
+			return false;
+		printlog(clock->app, 1, "[clock] Real time clock has been set.\n");
+	}
+
+	/* Picks up changes of the time zone. */
+	tzset();
+
+	arm_clock(clock);
+	return true;
+}
+
+/* Re-arms the clock for the next boundary in the current time zone. */
+bool clock_timezone_changed (struct Clock *clock)
+{
+	return arm_clock(clock);
+}
+
+/* A change of the time zone does not cancel timers, so boundaries of hours
+ * and days computed in the old one would stay until they pass. The zone is
+ * watched through /etc/localtime, which is usually a symlink replaced as a
+ * whole, so its directory is watched. Returns -1 if that is not possible,
+ * in which case changes are only picked up on the next expiration.
+ */
+int open_timezone_watch (struct App *app)
+{
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if ( fd == -1 )
+		return -1;
+	if ( inotify_add_watch(fd, "/etc", IN_CLOSE_WRITE | IN_MOVED_TO
+				| IN_CREATE | IN_DELETE) == -1 )
+	{
+		printlog(app, 1, "[clock] Can not watch /etc: %s\n", strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* Reads all pending events and returns true if /etc/localtime changed, in
+ * which case the new time zone has already been loaded.
+ */
+bool timezone_dispatch (struct App *app, int fd)
+{
+	_Alignas(struct inotify_event) char buffer[4096];
+	bool changed = false;
+	ssize_t len;
+	while ( (len = read(fd, buffer, sizeof(buffer))) > 0 )
+		for (char *ptr = buffer; ptr < buffer + len; )
+		{
+			struct inotify_event *event = (struct inotify_event *)ptr;
+			if ( event->len > 0 && ! strcmp(event->name, "localtime") )
+				changed = true;
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+
+	if (changed)
+	{
+		printlog(app, 1, "[clock] Time zone changed.\n");
+		tzset();
+	}
+	return changed;
+}
+
+size_t clock_format (struct Clock *clock, char *buffer, size_t size)
+{
+	time_t now = time(NULL);
+	struct tm tm;
+	localtime_r(&now, &tm);
+	return strftime(buffer, size, clock->format, &tm);
+}
+
+void finish_clock (struct Clock *clock)
+{
+	if ( clock->fd != -1 )
+		close(clock->fd);
+	clock->fd = -1;
+	free_if_set(clock->format);
+	clock->format = NULL;
+}
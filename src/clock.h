@@ -0,0 +1,31 @@
+#ifndef WLCLOCK_CLOCK_H
+#define WLCLOCK_CLOCK_H
+
+#include<stdbool.h>
+#include<stddef.h>
+#include<time.h>
+
+struct App;
+
+/* A clock only wakes up on the boundaries of the smallest unit its format
+ * shows, using an absolute timer on the real time clock.
+ */
+struct Clock
+{
+	struct App *app;
+	int         fd;
+	char       *format;
+	time_t      resolution;
+};
+
+time_t format_resolution (const char *format);
+time_t next_boundary (time_t now, time_t resolution);
+bool init_clock (struct Clock *clock, struct App *app, const char *format);
+bool clock_dispatch (struct Clock *clock);
+bool clock_timezone_changed (struct Clock *clock);
+int open_timezone_watch (struct App *app);
+bool timezone_dispatch (struct App *app, int fd);
+size_t clock_format (struct Clock *clock, char *buffer, size_t size);
+void finish_clock (struct Clock *clock);
+
+#endif
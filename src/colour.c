@@ -66,7 +66,7 @@ bool colour_from_string (struct Draw_colour *colour, const char *str)
 	return true;
 
 error:
-	printlog(NULL, 0, "ERROR: \"%s\" is not a valid colour.\n");
+	printlog(NULL, 0, "ERROR: \"%s\" is not a valid colour.\n", str);
 	return false;
 }
 
@@ -80,3 +80,33 @@ bool colour_is_transparent (struct Draw_colour *colour)
 	return colour->a == 0.0;
 }
 
+
+/* Sets the colour of the 256 colour palette of xterm: 16 basic colours, a
+ * 6x6x6 colour cube and 24 shades of grey.
+ */
+void colour_from_ansi_index (struct Draw_colour *colour, uint8_t index)
+{
+	static const uint8_t basic[16][3] = {
+		{   0,   0,   0 }, { 205,   0,   0 }, {   0, 205,   0 }, { 205, 205,   0 },
+		{   0,   0, 238 }, { 205,   0, 205 }, {   0, 205, 205 }, { 229, 229, 229 },
+		{ 127, 127, 127 }, { 255,   0,   0 }, {   0, 255,   0 }, { 255, 255,   0 },
+		{  92,  92, 255 }, { 255,   0, 255 }, {   0, 255, 255 }, { 255, 255, 255 },
+	};
+	static const uint8_t cube[6] = { 0, 95, 135, 175, 215, 255 };
+
+	uint8_t r, g, b;
+	if ( index < 16 )
+		r = basic[index][0], g = basic[index][1], b = basic[index][2];
+	else if ( index < 232 )
+	{
+		index -= 16;
+		r = cube[index / 36], g = cube[index / 6 % 6], b = cube[index % 6];
+	}
+	else
+		r = g = b = (uint8_t)(8 + 10 * (index - 232));
+
+	colour->r = (float)r / 255.0f;
+	colour->g = (float)g / 255.0f;
+	colour->b = (float)b / 255.0f;
+	colour->a = 1.0;
+}
@@ -2,6 +2,7 @@
 #define WLCLOCK_COLOUR_H
 
 #include<stdbool.h>
+#include<stdint.h>
 #include<cairo/cairo.h>
 
 struct Draw_colour
@@ -12,6 +13,7 @@ struct Draw_colour
 bool colour_from_string (struct Draw_colour *colour, const char *hex);
 void colour_set_cairo_source (cairo_t *cairo, struct Draw_colour *colour);
 bool colour_is_transparent (struct Draw_colour *colour);
+void colour_from_ansi_index (struct Draw_colour *colour, uint8_t index);
 
 #endif
 
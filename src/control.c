@@ -0,0 +1,338 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/socket.h>
+#include<sys/stat.h>
+#include<sys/un.h>
+
+#include<pango/pangocairo.h>
+
+#include"wayout.h"
+#include"misc.h"
+#include"colour.h"
+#include"control.h"
+#include"pane.h"
+#include"surface.h"
+#include"trace.h"
+
+/* The control socket accepts one command per line. All commands which
+ * arrive within one iteration of the main loop are applied before the next
+ * frame is rendered, so a batch of commands results in a single render.
+ * Every command is answered with "ok" or "error: <reason>".
+ */
+
+bool init_control (struct App *app)
+{
+	struct Control *control = &app->control;
+	for (size_t i = 0; i < CONTROL_MAX_CLIENTS; i++)
+		control->clients[i].fd = -1;
+
+	if ( control->path == NULL )
+		return true;
+
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if ( strlen(control->path) >= sizeof(addr.sun_path) )
+	{
+		printlog(NULL, 0, "ERROR: Control socket path is too long.\n");
+		return false;
+	}
+	strcpy(addr.sun_path, control->path);
+
+	/* Remove a stale socket left behind by a previous instance, but
+	 * never the socket of an instance still running.
+	 */
+	struct stat st;
+	if ( stat(control->path, &st) == 0 && S_ISSOCK(st.st_mode) )
+	{
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if ( fd == -1 )
+		{
+			printlog(NULL, 0, "ERROR: socket: %s\n", strerror(errno));
+			return false;
+		}
+		int ret = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+		int error = errno;
+		close(fd);
+		if ( ret == 0 )
+		{
+			printlog(NULL, 0, "ERROR: Control socket \"%s\" is in use by "
+					"another instance.\n", control->path);
+			return false;
+		}
+		if ( error != ECONNREFUSED )
+		{
+			printlog(NULL, 0, "ERROR: Can not check control socket \"%s\": %s\n",
+					control->path, strerror(error));
+			return false;
+		}
+		unlink(control->path);
+	}
+
+	if ( -1 == (control->fd = socket(AF_UNIX, SOCK_STREAM, 0))
+			|| -1 == bind(control->fd, (struct sockaddr *)&addr, sizeof(addr))
+			|| -1 == listen(control->fd, CONTROL_MAX_CLIENTS) )
+	{
+		printlog(NULL, 0, "ERROR: Can not open control socket \"%s\": %s\n",
+				control->path, strerror(errno));
+
+		/* The path may belong to someone else, so it is not removed. */
+		if ( control->fd != -1 )
+			close(control->fd);
+		control->fd = -1;
+		return false;
+	}
+	fcntl(control->fd, F_SETFD, FD_CLOEXEC);
+
+	printlog(app, 1, "[control] Listening on %s\n", control->path);
+	return true;
+}
+
+void control_accept (struct App *app)
+{
+	struct Control *control = &app->control;
+	int fd = accept(control->fd, NULL, NULL);
+	if ( fd == -1 )
+		return;
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	for (size_t i = 0; i < CONTROL_MAX_CLIENTS; i++)
+		if ( control->clients[i].fd == -1 )
+		{
+			printlog(app, 2, "[control] Client connected.\n");
+			control->clients[i].fd  = fd;
+			control->clients[i].len = 0;
+			return;
+		}
+
+	printlog(app, 1, "[control] Too many clients.\n");
+	close(fd);
+}
+
+static void close_client (struct App *app, struct Control_client *client)
+{
+	printlog(app, 2, "[control] Client disconnected.\n");
+	close(client->fd);
+	client->fd  = -1;
+	client->len = 0;
+}
+
+static void reply (struct Control_client *client, const char *str)
+{
+	send(client->fd, str, strlen(str), MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+/* Splits off the next space separated word. */
+static char *next_word (char **str)
+{
+	while ( **str == ' ' )
+		(*str)++;
+	if ( **str == '\0' )
+		return NULL;
+	char *word = *str;
+	while ( **str != ' ' && **str != '\0' )
+		(*str)++;
+	if ( **str == ' ' )
+		*(*str)++ = '\0';
+	return word;
+}
+
+/* Replaces the escape sequences "\n", "\t" and "\\" in place. */
+static size_t unescape (char *str)
+{
+	char *out = str;
+	for (char *in = str; *in != '\0'; in++)
+	{
+		if ( *in == '\\' && in[1] != '\0' )
+		{
+			in++;
+			*out++ = *in == 'n' ? '\n' : *in == 't' ? '\t' : *in;
+		}
+		else
+			*out++ = *in;
+	}
+	*out = '\0';
+	return (size_t)(out - str);
+}
+
+/* "-" refers to the first pane, which has no name unless --pane is used. */
+static struct Draw_pane *get_pane (struct App *app, const char *name)
+{
+	if ( name == NULL )
+		return NULL;
+	if (! strcmp(name, "-"))
+		return wl_container_of(app->panes.next, app->pane, link);
+	return get_pane_from_name(app, name);
+}
+
+static void reload (struct App *app)
+{
+	/* A new font map picks up fonts installed since it was created. */
+	drop_surface_caches(app);
+	if ( app->pango_context != NULL )
+	{
+		g_object_unref(app->pango_context);
+		app->pango_context = NULL;
+	}
+	pango_cairo_font_map_set_default(NULL);
+
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+		pane_set_font(pane, pane->font_pattern);
+	invalidate_surfaces(app);
+}
+
+static const char *execute (struct App *app, char *line)
+{
+	char *command = next_word(&line);
+	if ( command == NULL )
+		return NULL;
+
+	printlog(app, 2, "[control] Command: %s\n", command);
+
+	if (! strcmp(command, "set-text"))
+	{
+		struct Draw_pane *pane = get_pane(app, next_word(&line));
+		if ( pane == NULL )
+			return "unknown pane";
+		size_t len = unescape(line);
+		pane_set_text(pane, line, len);
+	}
+	else if (! strcmp(command, "set-font"))
+	{
+		struct Draw_pane *pane = get_pane(app, next_word(&line));
+		if ( pane == NULL )
+			return "unknown pane";
+		if ( *line == '\0' )
+			return "missing font pattern";
+		pane_set_font(pane, line);
+	}
+	else if (! strcmp(command, "set-colour") || ! strcmp(command, "set-color"))
+	{
+		/* Colour changes only repaint, they never require a new layout. */
+		char *what = next_word(&line);
+		struct Draw_colour colour, *target;
+		struct Draw_pane *pane = NULL;
+		if ( what == NULL )
+			return "missing target";
+		if (! strcmp(what, "background"))
+			target = &app->background_colour;
+		else if (! strcmp(what, "border"))
+			target = &app->border_colour;
+		else if (! strcmp(what, "text") || ! strcmp(what, "pane-background"))
+		{
+			if ( NULL == (pane = get_pane(app, next_word(&line))) )
+				return "unknown pane";
+			target = ! strcmp(what, "text") ? &pane->text_colour
+				: &pane->background_colour;
+		}
+		else
+			return "unknown target";
+		if (! colour_from_string(&colour, next_word(&line)))
+			return "invalid colour";
+		*target = colour;
+		if ( pane != NULL )
+			pane_touch(pane, false);
+		else
+			invalidate_surfaces(app);
+	}
+	else if (! strcmp(command, "set-size"))
+	{
+		char *w = next_word(&line), *h = next_word(&line);
+		if ( w == NULL || h == NULL || atoi(w) <= 0 || atoi(h) <= 0 )
+			return "invalid size";
+		app->dimensions.w = atoi(w);
+		app->dimensions.h = atoi(h);
+		reconfigure_surfaces(app);
+	}
+	else if (! strcmp(command, "set-position"))
+	{
+		char *position = next_word(&line);
+		if ( position == NULL || ! anchor_from_string(&app->anchor, position) )
+			return "invalid position";
+		reconfigure_surfaces(app);
+	}
+	else if (! strcmp(command, "scroll"))
+	{
+		struct Draw_pane *pane = get_pane(app, next_word(&line));
+		if ( pane == NULL )
+			return "unknown pane";
+		if (! pane_scroll(pane, next_word(&line)))
+			return "invalid offset";
+	}
+	else if (! strcmp(command, "reload"))
+		reload(app);
+	else if (! strcmp(command, "dump-trace"))
+	{
+#ifdef TRACING
+		if ( *line == '\0' )
+			return "missing path";
+		if (! trace_export(line))
+			return "can not write trace";
+		return NULL;
+#else
+		return "built without tracing";
+#endif
+	}
+	else
+		return "unknown command";
+
+	app->require_update = true;
+	return NULL;
+}
+
+void control_read (struct App *app, struct Control_client *client)
+{
+	ssize_t ret = read(client->fd, client->buffer + client->len,
+			CONTROL_BUFFERSIZE - client->len - 1);
+	if ( ret <= 0 )
+	{
+		if ( ret == 0 || errno != EINTR )
+			close_client(app, client);
+		return;
+	}
+	client->len += (size_t)ret;
+	client->buffer[client->len] = '\0';
+
+	char *start = client->buffer, *nl;
+	while ( NULL != (nl = strchr(start, '\n')) )
+	{
+		*nl = '\0';
+		const char *error = execute(app, start);
+		if ( error != NULL )
+		{
+			reply(client, "error: ");
+			reply(client, error);
+			reply(client, "\n");
+		}
+		else
+			reply(client, "ok\n");
+		start = nl + 1;
+	}
+
+	client->len -= (size_t)(start - client->buffer);
+	if ( client->len == CONTROL_BUFFERSIZE - 1 )
+	{
+		reply(client, "error: command too long\n");
+		client->len = 0;
+	}
+	else
+		memmove(client->buffer, start, client->len);
+}
+
+void finish_control (struct App *app)
+{
+	struct Control *control = &app->control;
+	if ( control->fd != -1 )
+	{
+		for (size_t i = 0; i < CONTROL_MAX_CLIENTS; i++)
+			if ( control->clients[i].fd != -1 )
+				close_client(app, &control->clients[i]);
+		close(control->fd);
+		unlink(control->path);
+	}
+	free_if_set(control->path);
+}
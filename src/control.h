@@ -0,0 +1,31 @@
+#ifndef WLCLOCK_CONTROL_H
+#define WLCLOCK_CONTROL_H
+
+#include<stdbool.h>
+#include<stddef.h>
+
+#define CONTROL_MAX_CLIENTS 8
+#define CONTROL_BUFFERSIZE 4096
+
+struct App;
+
+struct Control_client
+{
+	int    fd;
+	char   buffer[CONTROL_BUFFERSIZE];
+	size_t len;
+};
+
+struct Control
+{
+	char *path;
+	int   fd;
+	struct Control_client clients[CONTROL_MAX_CLIENTS];
+};
+
+bool init_control (struct App *app);
+void control_accept (struct App *app);
+void control_read (struct App *app, struct Control_client *client);
+void finish_control (struct App *app);
+
+#endif
@@ -0,0 +1,273 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+
+#include"wayout.h"
+#include"misc.h"
+#include"document.h"
+#include"utf8.h"
+
+void init_document (struct Document *document)
+{
+	memset(document, 0, sizeof(struct Document));
+	document->spool = -1;
+}
+
+static bool index_line (struct Document *document, size_t offset)
+{
+	if ( document->index_len == document->index_size )
+	{
+		size_t size = document->index_size == 0 ? 64 : document->index_size * 2;
+		size_t *index = realloc(document->index, size * sizeof(size_t));
+		if ( index == NULL )
+		{
+			printlog(NULL, 0, "ERROR: Could not allocate.\n");
+			return false;
+		}
+		document->index      = index;
+		document->index_size = size;
+	}
+	document->index[document->index_len++] = offset;
+	return true;
+}
+
+/* Uses the mapping of an input as the complete document. */
+bool document_map (struct Document *document, char *data, size_t len)
+{
+	document->data     = data;
+	document->len      = len;
+	document->mapped   = true;
+	document->complete = true;
+	return document->index_len > 0 || index_line(document, 0);
+}
+
+/* Creates a spool file in the given directory, removed right away so it
+ * does not outlive the process.
+ */
+static int create_spool (const char *dir)
+{
+	size_t len = strlen(dir) + sizeof("/wayout-XXXXXX");
+	char *path = malloc(len);
+	if ( path == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return -1;
+	}
+	snprintf(path, len, "%s/wayout-XXXXXX", dir);
+	int fd = mkstemp(path);
+	if ( fd != -1 )
+	{
+		unlink(path);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+	free(path);
+	return fd;
+}
+
+/* The /tmp of most systems is a tmpfs, which keeps the spool in memory, so
+ * it is created in $XDG_CACHE_HOME or /var/tmp, which are on disk, and only
+ * in $TMPDIR or /tmp if neither can be used.
+ */
+static bool open_spool (struct Document *document)
+{
+	document->chunk = malloc(DOCUMENT_READ_SIZE);
+	if ( document->chunk == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return false;
+	}
+
+	const char *tmpdir = getenv("TMPDIR");
+	const char *dirs[] = {
+		getenv("XDG_CACHE_HOME"),
+		"/var/tmp",
+		tmpdir != NULL && *tmpdir != '\0' ? tmpdir : "/tmp",
+	};
+	for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++)
+		if ( dirs[i] != NULL && *dirs[i] != '\0'
+				&& -1 != (document->spool = create_spool(dirs[i])) )
+			return true;
+
+	printlog(NULL, 0, "ERROR: Can not create spool file: %s\n", strerror(errno));
+	return false;
+}
+
+static bool write_spool (struct Document *document, const char *data, size_t len)
+{
+	while ( len > 0 )
+	{
+		ssize_t ret = write(document->spool, data, len);
+		if ( ret < 0 && errno == EINTR )
+			continue;
+		if ( ret <= 0 )
+		{
+			printlog(NULL, 0, "ERROR: Can not write spool file: %s\n",
+					strerror(errno));
+			return false;
+		}
+		data += ret;
+		len  -= (size_t)ret;
+	}
+	return true;
+}
+
+/* Maps everything spooled so far, before the data is accessed. The mapping
+ * reaches beyond the end of the file and doubles in size when the file
+ * outgrows it, so a growing spool is only mapped again a few times. Only
+ * the part up to len, which the file has, is ever accessed.
+ */
+static bool map_spool (struct Document *document)
+{
+	if ( document->spool == -1 || document->spool_mapped >= document->len )
+		return document->data != NULL || document->len == 0;
+
+	size_t size = document->spool_mapped > 0 ? document->spool_mapped
+		: DOCUMENT_MAP_MIN;
+	while ( size < document->len )
+		size *= 2;
+
+	if ( document->data != NULL )
+		munmap(document->data, document->spool_mapped);
+	document->data = mmap(NULL, size, PROT_READ, MAP_SHARED, document->spool, 0);
+	if ( document->data == MAP_FAILED )
+	{
+		printlog(NULL, 0, "ERROR: Can not map spool file: %s\n", strerror(errno));
+		document->data = NULL;
+		document->spool_mapped = 0;
+		return false;
+	}
+	document->spool_mapped = size;
+	return true;
+}
+
+/* Performs a single read() on the stream and appends the data to the
+ * spool. Returns false once the stream is exhausted or broken. Added is set
+ * if lines were completed.
+ */
+bool document_read (struct Document *document, int fd, bool *added)
+{
+	*added = false;
+	if ( document->index_len == 0 && ! index_line(document, 0) )
+		return false;
+	if ( document->spool == -1 && ! open_spool(document) )
+		return false;
+
+	errno = 0;
+	ssize_t ret = read(fd, document->chunk, DOCUMENT_READ_SIZE);
+	if ( ret < 0 )
+	{
+		if ( errno == EINTR || errno == EAGAIN )
+			return true;
+		printlog(NULL, 0, "ERROR: read: %s\n", strerror(errno));
+		return false;
+	}
+	if ( ret == 0 )
+	{
+		/* The last line may lack its newline. */
+		document->complete = true;
+		*added = document->len > 0 && document->last != '\n';
+		free_if_set(document->chunk);
+		document->chunk = NULL;
+		return false;
+	}
+
+	if (! write_spool(document, document->chunk, (size_t)ret))
+		return false;
+	*added = memchr(document->chunk, '\n', (size_t)ret) != NULL;
+	document->last = document->chunk[ret-1];
+	document->len += (size_t)ret;
+	return true;
+}
+
+/* Counts and indexes the lines up to and including the given one. */
+static void scan_lines (struct Document *document, uint64_t line)
+{
+	if (! map_spool(document))
+		return;
+	while ( document->lines <= line && document->scanned < document->len )
+	{
+		char *nl = memchr(document->data + document->scanned, '\n',
+				document->len - document->scanned);
+		if ( nl == NULL )
+			return;
+		document->scanned = (size_t)(nl - document->data) + 1;
+		document->lines++;
+		if ( document->lines % DOCUMENT_INDEX_STRIDE == 0
+				&& ! index_line(document, document->scanned) )
+			return;
+	}
+}
+
+/* Scans the entire document, which takes time proportional to its size. */
+uint64_t document_line_count (struct Document *document)
+{
+	scan_lines(document, UINT64_MAX - 1);
+	if ( document->complete && document->scanned < document->len )
+		return document->lines + 1;
+	return document->lines;
+}
+
+/* Returns a line without its newline, cut off and sanitised, or NULL if the
+ * document does not have it (yet). The line may only be used until the next
+ * call.
+ */
+const char *document_get_line (struct Document *document, uint64_t line, size_t *len)
+{
+	scan_lines(document, line);
+	if ( document->data == NULL )
+		return NULL;
+	bool last = line == document->lines && document->complete
+		&& document->scanned < document->len;
+	if ( line > document->lines || ( line == document->lines && ! last )
+			|| line / DOCUMENT_INDEX_STRIDE >= document->index_len )
+		return NULL;
+
+	const char *start = document->data + document->index[line / DOCUMENT_INDEX_STRIDE];
+	const char *end   = document->data + document->len;
+	for (uint64_t i = line % DOCUMENT_INDEX_STRIDE; i > 0; i--)
+		start = (const char *)memchr(start, '\n', (size_t)(end - start)) + 1;
+	const char *nl = memchr(start, '\n', (size_t)(end - start));
+	*len = (size_t)((nl == NULL ? end : nl) - start);
+	if ( *len > DOCUMENT_LINE_MAX )
+		*len = DOCUMENT_LINE_MAX;
+
+	if ( utf8_clean_prefix(start, *len) == *len )
+		return start;
+
+	free_if_set(document->scratch);
+	if ( NULL == (document->scratch = malloc(*len * UTF8_SANITISE_FACTOR + 1)) )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return NULL;
+	}
+	*len = utf8_sanitise(document->scratch, start, *len);
+	document->scratch[*len] = '\0';
+	return document->scratch;
+}
+
+/* Bytes held on the heap; Mappings are only paged in where they are read. */
+size_t document_memory (struct Document *document)
+{
+	return ( document->chunk != NULL ? DOCUMENT_READ_SIZE : 0 )
+		+ document->index_size * sizeof(size_t);
+}
+
+void finish_document (struct Document *document)
+{
+	if ( document->spool != -1 )
+	{
+		if ( document->data != NULL )
+			munmap(document->data, document->spool_mapped);
+		close(document->spool);
+	}
+	free_if_set(document->chunk);
+	free_if_set(document->index);
+	free_if_set(document->scratch);
+	init_document(document);
+}
@@ -0,0 +1,68 @@
+#ifndef WLCLOCK_DOCUMENT_H
+#define WLCLOCK_DOCUMENT_H
+
+#include<stdbool.h>
+#include<stddef.h>
+#include<stdint.h>
+
+/* Every DOCUMENT_INDEX_STRIDE-th line start is kept in the index, so finding
+ * a line scans at most that many lines.
+ */
+#define DOCUMENT_INDEX_STRIDE 64
+
+/* Lines are cut off after this many bytes, so laying out a line takes
+ * bounded time however long it is.
+ */
+#define DOCUMENT_LINE_MAX 4096
+
+/* Bytes read from a stream per wakeup. */
+#define DOCUMENT_READ_SIZE 65536
+
+/* Size of the first mapping of a spool, which is doubled as needed. */
+#define DOCUMENT_MAP_MIN (1 << 20)
+
+/* A read-only text addressed by line, either the mapping of a file or a
+ * stream, which is spooled into an unlinked temporary file mapped as far as
+ * it is needed. Either way, the text is paged in by the kernel rather than
+ * held on the heap. Lines are indexed lazily, only as far as they have been
+ * asked for.
+ */
+struct Document
+{
+	char  *data;
+	size_t len;
+	bool   mapped;
+
+	/* The spool of a stream, the size of its current mapping, which may
+	 * exceed the file, the buffer a single read() goes to and the last
+	 * byte read.
+	 */
+	int    spool;
+	size_t spool_mapped;
+	char  *chunk;
+	char   last;
+
+	/* Set at EOF, after which a last line without newline counts. */
+	bool   complete;
+
+	/* The data up to scanned holds lines complete lines. index[i] is the
+	 * offset of line i * DOCUMENT_INDEX_STRIDE.
+	 */
+	size_t  *index;
+	size_t   index_len, index_size;
+	size_t   scanned;
+	uint64_t lines;
+
+	/* Holds the last line returned if it had to be sanitised. */
+	char *scratch;
+};
+
+void init_document (struct Document *document);
+bool document_map (struct Document *document, char *data, size_t len);
+bool document_read (struct Document *document, int fd, bool *added);
+uint64_t document_line_count (struct Document *document);
+const char *document_get_line (struct Document *document, uint64_t line, size_t *len);
+size_t document_memory (struct Document *document);
+void finish_document (struct Document *document);
+
+#endif
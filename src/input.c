@@ -0,0 +1,318 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<string.h>
+#include<errno.h>
+#include<unistd.h>
+#include<sys/uio.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+
+#include"wayout.h"
+#include"input.h"
+#include"misc.h"
+
+void init_input (struct Input *input, struct App *app, int fd)
+{
+	input->app        = app;
+	input->fd         = fd;
+	input->data       = NULL;
+	input->record     = NULL;
+	input->data_len   = 0;
+	input->discard    = false;
+	input->record_len = 0;
+	input->map        = NULL;
+	input->map_size   = 0;
+	input->header_len      = 0;
+	input->header_need     = FRAME_HEADER_SIZE;
+	input->payload_left    = 0;
+	input->payload_discard = false;
+	input->sequenced       = false;
+	input->last_sequence   = 0;
+}
+
+/* Maps the input if it is a non-empty regular file and not a feed, so its
+ * content can be used without copying it. The input is finished afterwards,
+ * except for the mapping itself.
+ */
+bool input_map (struct Input *input)
+{
+	struct stat st;
+	if ( input->feed || fstat(input->fd, &st) == -1 || ! S_ISREG(st.st_mode)
+			|| st.st_size == 0 )
+		return false;
+
+	void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, input->fd, 0);
+	if ( map == MAP_FAILED )
+		return false;
+
+	printlog(input->app, 2, "[input] Mapped %zu bytes.\n", (size_t)st.st_size);
+	input->map      = map;
+	input->map_size = (size_t)st.st_size;
+	if ( input->fd > STDIN_FILENO )
+		close(input->fd);
+	input->fd = -1;
+	return true;
+}
+
+static void flush_record (struct Input *input, input_record_func func, void *data)
+{
+	if ( input->record_len == 0 )
+		return;
+	input->record[input->record_len] = '\0';
+	func(data, input->record, input->record_len);
+	input->record_len = 0;
+}
+
+static bool is_delimiter (struct Input *input, const char *line, size_t len)
+{
+	/* The delimiter of paragraph mode is "\n", which matches an empty
+	 * line, just like "---" matches a line only containing "---".
+	 */
+	size_t dlen = strlen(input->delimiter);
+	if ( dlen > 0 && input->delimiter[dlen-1] == '\n' )
+		dlen--;
+	return len == dlen && ! strncmp(line, input->delimiter, len);
+}
+
+/* Handle a single line, including its trailing newline if it has one. */
+static void handle_line (struct Input *input, const char *line, size_t len,
+		input_record_func func, void *data)
+{
+	if ( input->feed && input->delimiter == NULL )
+	{
+		if ( len > 0 && line[len-1] == '\n' )
+			len--;
+		memcpy(input->record, line, len);
+		input->record_len = len;
+		flush_record(input, func, data);
+		return;
+	}
+
+	if ( input->feed && is_delimiter(input, line,
+				len > 0 && line[len-1] == '\n' ? len - 1 : len) )
+	{
+		flush_record(input, func, data);
+		return;
+	}
+
+	if ( input->record_len + len >= BUFFERSIZE )
+	{
+		printlog(input->app, 2, "Buffer size exceeded.. ignoring line\n");
+		input->app->stats.records_dropped++;
+		return;
+	}
+	memcpy(input->record + input->record_len, line, len);
+	input->record_len += len;
+}
+
+static uint64_t read_le (const uint8_t *ptr, size_t size)
+{
+	uint64_t ret = 0;
+	for (size_t i = size; i > 0; i--)
+		ret = (ret << 8) | ptr[i-1];
+	return ret;
+}
+
+/* Handles a completely read header. Returns false if it is not complete yet
+ * because of optional fields.
+ */
+static bool handle_header (struct Input *input)
+{
+	uint32_t length = (uint32_t)read_le(input->header, 4);
+	uint16_t flags  = (uint16_t)read_le(input->header + 4, 2);
+
+	size_t need = FRAME_HEADER_SIZE;
+	if ( flags & FRAME_SEQUENCE )
+		need += 8;
+	if ( flags & FRAME_TIMESTAMP )
+		need += 8;
+	if ( input->header_len < need )
+	{
+		input->header_need = need;
+		return false;
+	}
+
+	const uint8_t *field = input->header + FRAME_HEADER_SIZE;
+	input->frame_flags     = flags;
+	input->frame_sequence  = 0;
+	input->frame_timestamp = 0;
+	if ( flags & FRAME_SEQUENCE )
+	{
+		input->frame_sequence = read_le(field, 8);
+		field += 8;
+	}
+	if ( flags & FRAME_TIMESTAMP )
+		input->frame_timestamp = read_le(field, 8);
+
+	input->header_len      = 0;
+	input->header_need     = FRAME_HEADER_SIZE;
+	input->record_len      = 0;
+	input->payload_left    = length;
+
+	/* Frames arriving out of order are dropped, so an older frame never
+	 * replaces a newer one.
+	 */
+	input->payload_discard = true;
+	if ( length >= BUFFERSIZE )
+		printlog(input->app, 2, "Frame size exceeded.. ignoring frame\n");
+	else if ( flags & FRAME_SEQUENCE && input->sequenced
+			&& input->frame_sequence <= input->last_sequence )
+		printlog(input->app, 2, "Stale frame %lu.. ignoring frame\n",
+				(unsigned long)input->frame_sequence);
+	else
+		input->payload_discard = false;
+	if (input->payload_discard)
+	{
+		input->app->stats.records_dropped++;
+		return true;
+	}
+
+	if ( flags & FRAME_SEQUENCE )
+	{
+		input->sequenced     = true;
+		input->last_sequence = input->frame_sequence;
+	}
+	return true;
+}
+
+/* Reads the rest of the current payload and the next header with a single
+ * readv(), so a stream of frames costs about one system call per frame.
+ */
+static bool input_read_framed (struct Input *input, input_record_func func, void *data)
+{
+	struct iovec iov[2];
+	int iovcnt = 0;
+	if ( input->payload_left > 0 )
+	{
+		iov[iovcnt].iov_base = input->payload_discard ? input->data
+			: input->record + input->record_len;
+		iov[iovcnt++].iov_len = input->payload_discard
+			&& input->payload_left > BUFFERSIZE ? BUFFERSIZE
+			: input->payload_left;
+	}
+	iov[iovcnt].iov_base  = input->header + input->header_len;
+	iov[iovcnt++].iov_len = input->header_need - input->header_len;
+
+	errno = 0;
+	ssize_t ret = readv(input->fd, iov, iovcnt);
+	if ( ret < 0 )
+	{
+		if ( errno == EINTR || errno == EAGAIN )
+			return true;
+		printlog(NULL, 0, "ERROR: read: %s\n", strerror(errno));
+		return false;
+	}
+	if ( ret == 0 )
+		return false;
+
+	size_t len = (size_t)ret;
+	if ( input->payload_left > 0 )
+	{
+		size_t payload = len < iov[0].iov_len ? len : iov[0].iov_len;
+		input->payload_left -= payload;
+		len -= payload;
+		if (! input->payload_discard)
+			input->record_len += payload;
+		if ( input->payload_left == 0 && ! input->payload_discard )
+		{
+			input->record[input->record_len] = '\0';
+			func(data, input->record, input->record_len);
+		}
+	}
+	input->header_len += len;
+
+	if ( input->header_len == input->header_need && handle_header(input)
+			&& input->payload_left == 0 && ! input->payload_discard )
+	{
+		input->record[0] = '\0';
+		func(data, input->record, 0);
+	}
+
+	return true;
+}
+
+/* Performs a single read() on the input, which will not block after poll()
+ * reported the fd as readable, and emits all records completed by it.
+ * Returns false once the input is exhausted or broken.
+ */
+bool input_read (struct Input *input, input_record_func func, void *data)
+{
+	if ( input->data == NULL )
+	{
+		input->data   = malloc(BUFFERSIZE);
+		input->record = malloc(BUFFERSIZE);
+		if ( input->data == NULL || input->record == NULL )
+		{
+			printlog(NULL, 0, "ERROR: Could not allocate.\n");
+			free_if_set(input->data);
+			free_if_set(input->record);
+			input->data = input->record = NULL;
+			return false;
+		}
+	}
+
+	if (input->framed)
+		return input_read_framed(input, func, data);
+
+	errno = 0;
+	ssize_t ret = read(input->fd, input->data + input->data_len,
+			BUFFERSIZE - input->data_len);
+	if ( ret < 0 )
+	{
+		if ( errno == EINTR || errno == EAGAIN )
+			return true;
+		printlog(NULL, 0, "ERROR: read: %s\n", strerror(errno));
+		return false;
+	}
+
+	if ( ret == 0 )
+	{
+		/* EOF: process all remaining input. */
+		if ( input->data_len > 0 && ! input->discard )
+			handle_line(input, input->data, input->data_len, func, data);
+		input->data_len = 0;
+		flush_record(input, func, data);
+		return false;
+	}
+
+	input->data_len += (size_t)ret;
+
+	char *start = input->data, *end = input->data + input->data_len, *nl;
+	while ( NULL != (nl = memchr(start, '\n', (size_t)(end - start))) )
+	{
+		if (! input->discard)
+			handle_line(input, start, (size_t)(nl - start + 1), func, data);
+		input->discard = false;
+		start = nl + 1;
+	}
+
+	input->data_len = (size_t)(end - start);
+	if ( input->data_len == BUFFERSIZE )
+	{
+		/* A line which does not fit into the buffer is dropped up to
+		 * and including its newline.
+		 */
+		printlog(input->app, 2, "Buffer size exceeded.. ignoring line\n");
+		input->app->stats.records_dropped++;
+		input->discard  = true;
+		input->data_len = 0;
+	}
+	else if ( start != input->data )
+		memmove(input->data, start, input->data_len);
+
+	return true;
+}
+
+void finish_input (struct Input *input)
+{
+	if ( input->map != NULL )
+		munmap(input->map, input->map_size);
+	input->map = NULL;
+	if ( input->fd > STDIN_FILENO )
+		close(input->fd);
+	input->fd = -1;
+	free_if_set(input->data);
+	free_if_set(input->record);
+	input->data = input->record = NULL;
+}
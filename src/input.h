@@ -0,0 +1,82 @@
+#ifndef WLCLOCK_INPUT_H
+#define WLCLOCK_INPUT_H
+
+#include<stdbool.h>
+#include<stddef.h>
+#include<stdint.h>
+
+#define BUFFERSIZE 65536
+
+/* A frame starts with a little endian header: a 32 bit payload length, 16 bit
+ * flags and 16 reserved bits. The flags FRAME_SEQUENCE and FRAME_TIMESTAMP
+ * each append a 64 bit field to the header, in that order. The timestamp is
+ * in nanoseconds of CLOCK_REALTIME.
+ */
+#define FRAME_HEADER_SIZE 8
+#define FRAME_HEADER_MAX  24
+
+#define FRAME_MARKUP    (1 << 0)
+#define FRAME_APPEND    (1 << 1)
+#define FRAME_SEQUENCE  (1 << 2)
+#define FRAME_TIMESTAMP (1 << 3)
+
+/* Called for every complete record. The record is NUL terminated, but may
+ * only be used until the callback returns.
+ */
+typedef void (*input_record_func) (void *data, const char *record, size_t len);
+
+struct App;
+
+struct Input
+{
+	struct App *app;
+	int         fd;
+
+	/* In feed mode, records are emitted as soon as they are complete,
+	 * otherwise the entire input is a single record emitted at EOF.
+	 * A NULL delimiter makes every line a record, otherwise a line equal
+	 * to the delimiter terminates the record.
+	 */
+	bool  feed;
+	char *delimiter;
+
+	/* Bytes read but not yet split into lines, and the record under
+	 * construction. Both take BUFFERSIZE bytes and are only allocated on
+	 * the first read, so panes which never read a stream do not pay for
+	 * them.
+	 */
+	char  *data;
+	size_t data_len;
+	bool   discard;
+	char  *record;
+	size_t record_len;
+
+	/* In framed mode, every record is preceded by a header and read into
+	 * the record buffer without scanning it for delimiters.
+	 */
+	bool     framed;
+	uint8_t  header[FRAME_HEADER_MAX];
+	size_t   header_len, header_need;
+	size_t   payload_left;
+	bool     payload_discard;
+
+	/* Header of the last complete frame, and the sequence number of the
+	 * last frame accepted, if any had one.
+	 */
+	uint16_t frame_flags;
+	uint64_t frame_sequence;
+	uint64_t frame_timestamp;
+	bool     sequenced;
+	uint64_t last_sequence;
+
+	/* A regular file read in one go is mapped instead. */
+	void   *map;
+	size_t  map_size;
+};
+
+void init_input (struct Input *input, struct App *app, int fd);
+bool input_map (struct Input *input);
+bool input_read (struct Input *input, input_record_func func, void *data);
+void finish_input (struct Input *input);
+
+#endif
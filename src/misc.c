@@ -4,6 +4,7 @@
 #include<stdlib.h>
 #include<string.h>
 #include<unistd.h>
+#include<time.h>
 
 #include"wayout.h"
 
@@ -44,3 +45,60 @@ bool is_boolean_false (const char *in)
 	return false;
 }
 
+
+bool anchor_from_string (int32_t *anchor, const char *in)
+{
+	if (! strcmp(in, "center"))
+		*anchor = 0;
+	else if (! strcmp(in, "top"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP;
+	else if (! strcmp(in, "right"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
+	else if (! strcmp(in, "bottom"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM;
+	else if (! strcmp(in, "left"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT;
+	else if (! strcmp(in, "top-left"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP
+			| ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT;
+	else if (! strcmp(in, "top-right"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP
+			| ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
+	else if (! strcmp(in, "bottom-left"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM
+			| ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT;
+	else if (! strcmp(in, "bottom-right"))
+		*anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM
+			| ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
+	else
+	{
+		printlog(NULL, 0, "ERROR: Unrecognized position \"%s\".\n"
+				"INFO: Possible positisions are 'center', "
+				"'top', 'right', 'bottom', 'left', "
+				"'top-right', 'top-left', 'bottom-right', 'bottom-left'.\n",
+				in);
+		return false;
+	}
+	return true;
+}
+
+uint64_t monotonic_ns (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* Converts a time in nanoseconds of CLOCK_REALTIME to CLOCK_MONOTONIC.
+ * Times in the future are taken as now.
+ */
+uint64_t realtime_to_monotonic (uint64_t time)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	uint64_t realtime = (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+	uint64_t now = monotonic_ns();
+	if ( time >= realtime || realtime - time >= now )
+		return now;
+	return now - (realtime - time);
+}
@@ -2,6 +2,7 @@
 #define WLCLOCK_MISC_H
 
 #include<stdbool.h>
+#include<stdint.h>
 
 struct App;
 
@@ -10,5 +11,8 @@ void set_string (char **ptr, char *arg);
 void printlog (struct App *app, int level, const char *fmt, ...);
 bool is_boolean_true (const char *in);
 bool is_boolean_false (const char *in);
+bool anchor_from_string (int32_t *anchor, const char *in);
+uint64_t monotonic_ns (void);
+uint64_t realtime_to_monotonic (uint64_t time);
 
 #endif
@@ -10,6 +10,7 @@
 #include<wayland-client-protocol.h>
 
 #include"xdg-output-unstable-v1-protocol.h"
+#include"wlr-output-power-management-unstable-v1-protocol.h"
 #include"xdg-shell-protocol.h"
 
 #include"wayout.h"
@@ -52,13 +53,13 @@ static void output_handle_done (void *data, struct wl_output *wl_output)
 		if ( app->output == NULL || ! strcmp(app->output, output->name) )
 			create_surface(output);
 	}
-	else if (!output->surface->configured)
+	else if ( output->surface->configured && output->surface->scale != output->scale )
 	{
-		/* If we already have a widget on an output, it might need a new
-		 * frame, for example if the output's scale changed.
+		/* If we already have a widget on an output, it needs a new
+		 * frame if the output's scale changed.
 		 */
-		render_background_frame(output->surface);
-		wl_surface_commit(output->surface->background_surface);
+		output->surface->seq = ++output->app->seq;
+		schedule_frame(output->surface);
 	}
 }
 
@@ -90,6 +91,60 @@ static const struct zxdg_output_v1_listener xdg_output_listener = {
 	.done             = noop
 };
 
+static void output_power_handle_mode (void *data,
+		struct zwlr_output_power_v1 *power, uint32_t mode)
+{
+	struct Draw_output *output = (struct Draw_output *)data;
+	bool powered = mode == ZWLR_OUTPUT_POWER_V1_MODE_ON;
+	printlog(output->app, 1, "[output] Power mode: global_name=%d powered=%d\n",
+			output->global_name, powered);
+	if ( output->powered == powered )
+		return;
+	output->powered = powered;
+	if ( output->surface == NULL )
+		return;
+	if (powered)
+		resume_surface(output->surface);
+	else
+		suspend_surface(output->surface);
+}
+
+static void output_power_handle_failed (void *data,
+		struct zwlr_output_power_v1 *power)
+{
+	/* Another client may have exclusive control, in which case the
+	 * power state is simply unknown.
+	 */
+	struct Draw_output *output = (struct Draw_output *)data;
+	printlog(output->app, 1, "[output] Power mode unavailable: global_name=%d\n",
+			output->global_name);
+	zwlr_output_power_v1_destroy(output->power);
+	output->power = NULL;
+	if (output->powered)
+		return;
+	output->powered = true;
+	if ( output->surface != NULL )
+		resume_surface(output->surface);
+}
+
+static const struct zwlr_output_power_v1_listener output_power_listener = {
+	.mode   = output_power_handle_mode,
+	.failed = output_power_handle_failed,
+};
+
+/* Starts tracking the power mode of the output, if the compositor supports
+ * that. The current mode is sent right away.
+ */
+void output_track_power (struct Draw_output *output)
+{
+	struct App *app = output->app;
+	if ( app->output_power_manager == NULL || output->power != NULL )
+		return;
+	output->power = zwlr_output_power_manager_v1_get_output_power(
+			app->output_power_manager, output->wl_output);
+	zwlr_output_power_v1_add_listener(output->power, &output_power_listener, output);
+}
+
 bool configure_output (struct Draw_output *output)
 {
 	struct App *app = output->app;
@@ -124,10 +179,13 @@ bool create_output (struct App *app, struct wl_registry *registry,
 	output->wl_output   = wl_output;
 	output->configured  = false;
 	output->name        = NULL;
+	output->power       = NULL;
+	output->powered     = true;
 
 	wl_list_insert(&app->outputs, &output->link);
 	wl_output_set_user_data(wl_output, output);
 	wl_output_add_listener(wl_output, &output_listener, output);
+	output_track_power(output);
 
 	/* We can only use the output if we have both xdg_output_manager and
 	 * the layer_shell. If either one is not available yet, we have to
@@ -158,7 +216,9 @@ void destroy_output (struct Draw_output *output)
 	if ( output == NULL )
 		return;
 	 if ( output->surface != NULL )
-		destroy_surface(output->surface);
+		park_surface(output->surface);
+	if ( output->power != NULL )
+		zwlr_output_power_v1_destroy(output->power);
 	wl_list_remove(&output->link);
 	wl_output_destroy(output->wl_output);
 	free(output);
@@ -170,5 +230,6 @@ void destroy_all_outputs (struct App *app)
 	struct Draw_output *op, *tmp;
 	wl_list_for_each_safe(op, tmp, &app->outputs, link)
 		destroy_output(op);
+	prune_parked_surfaces(app, true);
 }
 
@@ -20,12 +20,19 @@ struct Draw_output
 
 	bool configured;
 
+	/* Whether the output is powered on. Outputs are assumed to be on if
+	 * the compositor does not tell.
+	 */
+	struct zwlr_output_power_v1 *power;
+	bool                         powered;
+
 	struct Draw_surface *surface;
 };
 
 bool create_output (struct App *app, struct wl_registry *registry,
 		uint32_t name, const char *interface, uint32_t version);
 bool configure_output (struct Draw_output *output);
+void output_track_power (struct Draw_output *output);
 struct Draw_output *get_output_from_global_name (struct App *app, uint32_t name);
 void destroy_output (struct Draw_output *output);
 void destroy_all_outputs (struct App *app);
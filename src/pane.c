@@ -0,0 +1,769 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/stat.h>
+
+#include<pango/pangocairo.h>
+
+#include"wayout.h"
+#include"misc.h"
+#include"colour.h"
+#include"input.h"
+#include"pane.h"
+#include"render.h"
+#include"utf8.h"
+#include"ansi.h"
+
+/* Creates a new pane. Its style is inherited from the pane created before,
+ * so options given before the first --pane act as defaults for all panes.
+ */
+struct Draw_pane *create_pane (struct App *app, const char *name)
+{
+	struct Draw_pane *pane = calloc(1, sizeof(struct Draw_pane));
+	if ( pane == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return NULL;
+	}
+
+	struct Draw_pane *prev = app->pane;
+
+	pane->app   = app;
+	pane->index = (size_t)wl_list_length(&app->panes);
+	pane->name  = name == NULL ? NULL : strdup(name);
+	pane->x = pane->y = pane->w = pane->h = 0;
+	pane->path  = NULL;
+	pane->text  = NULL;
+	pane->text_len = 0;
+	pane->text_borrowed = false;
+	pane->markup = true;
+	pane->source = PANE_SOURCE_INPUT;
+	pane->seq   = 0;
+	pane->layout_seq = 0;
+	pane->redraw_seq = 0;
+	pane->style_seq = 0;
+	pane->dirty = false;
+	pane->record_time = 0;
+	pane->tail_lines = NULL;
+	pane->tail_lens  = NULL;
+	pane->tail_attrs = NULL;
+	pane->tail_total = 0;
+	pane->attrs = NULL;
+	pane->raw   = NULL;
+	pane->raw_len = 0;
+	pane->scroll = 0;
+	pane->document_visible = 0;
+	init_document(&pane->doc);
+	init_input(&pane->input, app, -1);
+	pane->file_watch.fd = pane->clock.fd = pane->template.fd = -1;
+
+	if ( prev != NULL )
+	{
+		pane->font_pattern      = strdup(prev->font_pattern);
+		pane->text_colour       = prev->text_colour;
+		pane->background_colour = prev->background_colour;
+		pane->wordwrap          = prev->wordwrap;
+		pane->center            = prev->center;
+		pane->input.feed        = prev->input.feed;
+		pane->input.delimiter   = prev->input.delimiter;
+		pane->input.framed      = prev->input.framed;
+		pane->tail              = prev->tail;
+		pane->document          = prev->document;
+		pane->ansi              = prev->ansi;
+		pane->markup            = prev->markup;
+	}
+	else
+	{
+		pane->font_pattern = strdup("Monospace 26");
+		pane->wordwrap     = true;
+		pane->center       = false;
+		colour_from_string(&pane->text_colour,       "#ffffff");
+		colour_from_string(&pane->background_colour, "#00000000");
+		pane->input.feed      = false;
+		pane->input.delimiter = NULL;
+		pane->input.framed    = false;
+		pane->tail            = 0;
+		pane->document        = false;
+	}
+
+	wl_list_insert(app->panes.prev, &pane->link);
+	app->pane = pane;
+	return pane;
+}
+
+/* Parses "x,y,w,h". */
+bool pane_set_geometry (struct Draw_pane *pane, const char *str)
+{
+	int32_t x, y, w, h;
+	if ( 4 != sscanf(str, "%d,%d,%d,%d", &x, &y, &w, &h)
+			|| x < 0 || y < 0 || w < 0 || h < 0 )
+	{
+		printlog(NULL, 0, "ERROR: \"%s\" is not a valid pane geometry.\n"
+				"INFO: Expected \"x,y,width,height\".\n", str);
+		return false;
+	}
+	pane->x = x;
+	pane->y = y;
+	pane->w = w;
+	pane->h = h;
+	return true;
+}
+
+/* Gets the rectangle of the pane in surface coordinates (unscaled). */
+void pane_get_rect (struct Draw_pane *pane, struct Draw_dimensions *dimensions,
+		int32_t *x, int32_t *y, int32_t *w, int32_t *h)
+{
+	struct App *app = pane->app;
+	int32_t area_w = dimensions->w - app->border_left - app->border_right;
+	int32_t area_h = dimensions->h - app->border_top - app->border_bottom;
+
+	*x = app->border_left + pane->x;
+	*y = app->border_top  + pane->y;
+	*w = pane->w == 0 || pane->x + pane->w > area_w ? area_w - pane->x : pane->w;
+	*h = pane->h == 0 || pane->y + pane->h > area_h ? area_h - pane->y : pane->h;
+	if ( *w < 0 )
+		*w = 0;
+	if ( *h < 0 )
+		*h = 0;
+}
+
+/* Returns a copy of the text which is valid UTF-8 free of control
+ * characters, updating len, or NULL if the text is clean and does not have
+ * to be copied for that reason.
+ */
+static char *sanitise (struct Draw_pane *pane, const char *text, size_t *len,
+		bool *failed)
+{
+	*failed = false;
+	if ( utf8_clean_prefix(text, *len) == *len )
+		return NULL;
+
+	char *sanitised = malloc(*len * UTF8_SANITISE_FACTOR + 1);
+	if ( sanitised == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		*failed = true;
+		return NULL;
+	}
+	*len = utf8_sanitise(sanitised, text, *len);
+	sanitised[*len] = '\0';
+	printlog(pane->app, 2, "[pane] Sanitised record: name=%s size=%zu\n",
+			pane->name, *len);
+	return sanitised;
+}
+
+/* Returns the text without escape sequences, sanitised, and the attributes
+ * of the SGR sequences in it, or NULL on failure.
+ */
+static char *parse_ansi (struct Draw_pane *pane, const char *text, size_t *len,
+		PangoAttrList **attrs)
+{
+	char *plain = malloc(*len * UTF8_SANITISE_FACTOR + 1);
+	if ( plain == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return NULL;
+	}
+	*attrs = pango_attr_list_new();
+	*len = ansi_parse(plain, *attrs, text, *len, &pane->text_colour,
+			&pane->background_colour);
+	plain[*len] = '\0';
+	return plain;
+}
+
+/* Adds a line to the tail, replacing the oldest one once it is full. */
+static void tail_push (struct Draw_pane *pane, const char *text, size_t len)
+{
+	PangoAttrList *attrs = NULL;
+	char *line;
+	if (pane->ansi)
+	{
+		if ( NULL == (line = parse_ansi(pane, text, &len, &attrs)) )
+			return;
+	}
+	else
+	{
+		bool failed;
+		line = sanitise(pane, text, &len, &failed);
+		if (failed)
+			return;
+		if ( line == NULL && NULL == (line = strndup(text, len)) )
+		{
+			printlog(NULL, 0, "ERROR: Could not allocate.\n");
+			return;
+		}
+	}
+
+	size_t slot = (size_t)(pane->tail_total % pane->tail);
+	free_if_set(pane->tail_lines[slot]);
+	if ( pane->tail_attrs[slot] != NULL )
+		pango_attr_list_unref(pane->tail_attrs[slot]);
+	pane->tail_lines[slot] = line;
+	pane->tail_lens[slot]  = len;
+	pane->tail_attrs[slot] = attrs;
+	pane->tail_total++;
+
+	pane->seq   = ++pane->app->seq;
+	pane->dirty = true;
+}
+
+static void set_text (struct Draw_pane *pane, const char *text, size_t len,
+		bool borrowed)
+{
+	struct App *app = pane->app;
+	printlog(app, 2, "[pane] New text: name=%s size=%zu\n", pane->name, len);
+
+	if ( pane->tail > 0 )
+	{
+		tail_push(pane, text, len);
+		return;
+	}
+
+	/* Text is validated once here, so Pango never sees invalid UTF-8 or
+	 * control characters. Only text which is not clean is copied, unless
+	 * escape sequences have to be stripped.
+	 */
+	PangoAttrList *attrs = NULL;
+	char *sanitised;
+	if (pane->ansi)
+	{
+		char *raw = malloc(len + 1);
+		if ( raw == NULL )
+		{
+			printlog(NULL, 0, "ERROR: Could not allocate.\n");
+			return;
+		}
+		memcpy(raw, text, len);
+		raw[len] = '\0';
+		size_t raw_len = len;
+		if ( NULL == (sanitised = parse_ansi(pane, text, &len, &attrs)) )
+		{
+			free(raw);
+			return;
+		}
+		free_if_set(pane->raw);
+		pane->raw     = raw;
+		pane->raw_len = raw_len;
+	}
+	else
+	{
+		bool failed;
+		sanitised = sanitise(pane, text, &len, &failed);
+		if (failed)
+			return;
+	}
+	if ( pane->attrs != NULL )
+		pango_attr_list_unref(pane->attrs);
+	pane->attrs = attrs;
+
+	if (! pane->text_borrowed)
+		free_if_set(pane->text);
+	if ( sanitised != NULL )
+		pane->text  = sanitised;
+	else
+		pane->text  = borrowed ? (char *)text : strndup(text, len);
+	pane->text_len      = len;
+	pane->text_borrowed = borrowed && sanitised == NULL;
+	pane->seq = pane->layout_seq = ++app->seq;
+	pane->dirty = true;
+
+	/* Feeds are rendered at the pace of the timer, everything else as
+	 * soon as possible.
+	 */
+	if ( pane->source != PANE_SOURCE_INPUT || ! pane->input.feed )
+		app->require_update = true;
+}
+
+/* Re-reads a watched file, but only updates the pane if the content
+ * actually changed.
+ */
+static void reload_file (struct Draw_pane *pane)
+{
+	int fd = open(pane->path, O_RDONLY | O_CLOEXEC);
+	if ( fd == -1 )
+	{
+		printlog(pane->app, 2, "[pane] Can not open \"%s\": %s\n",
+				pane->path, strerror(errno));
+		return;
+	}
+
+	char *buffer = malloc(BUFFERSIZE);
+	if ( buffer == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		close(fd);
+		return;
+	}
+	size_t len = 0;
+	ssize_t ret;
+	while ( len < BUFFERSIZE - 1
+			&& (ret = read(fd, buffer + len, BUFFERSIZE - 1 - len)) > 0 )
+		len += (size_t)ret;
+	close(fd);
+
+	if ( len > 0 && buffer[len-1] == '\n' )
+		len--;
+	if (watch_content_changed(&pane->file_watch, buffer, len))
+		set_text(pane, buffer, len, false);
+	free(buffer);
+}
+
+static void update_clock (struct Draw_pane *pane)
+{
+	char buffer[256];
+	size_t len = clock_format(&pane->clock, buffer, sizeof(buffer));
+	set_text(pane, buffer, len, false);
+}
+
+/* Returns the first pane reading stdin, which reads the records of all
+ * stdin panes and routes them by their tag.
+ */
+static struct Draw_pane *get_stdin_pane (struct App *app)
+{
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+		if ( pane->source == PANE_SOURCE_INPUT && pane->path == NULL )
+			return pane;
+	return NULL;
+}
+
+static void document_changed (struct Draw_pane *pane)
+{
+	if ( pane->record_time == 0 )
+		pane->record_time = monotonic_ns();
+	pane->seq   = ++pane->app->seq;
+	pane->dirty = true;
+	pane->app->require_update = true;
+}
+
+/* Uses the input of a document pane directly if it is a regular file,
+ * otherwise it is read as a stream.
+ */
+static bool map_document (struct Draw_pane *pane)
+{
+	if (! input_map(&pane->input))
+		return true;
+	if (! document_map(&pane->doc, pane->input.map, pane->input.map_size))
+		return false;
+	document_changed(pane);
+	return true;
+}
+
+/* Loads the font of the pane and opens its input. */
+bool init_pane (struct Draw_pane *pane)
+{
+	pane->font_description = pango_font_description_from_string(pane->font_pattern);
+
+	/* Loading the font the first time sets up fontconfig, which is slow
+	 * enough to be worth doing while the compositor is still answering
+	 * the initial requests, instead of when the first frame is due.
+	 */
+	PangoFont *font = pango_context_load_font(get_pango_context(pane->app),
+			pane->font_description);
+	if ( font != NULL )
+		g_object_unref(font);
+
+	if ( pane->source != PANE_SOURCE_INPUT )
+		pane->tail = 0;
+	if ( pane->source != PANE_SOURCE_INPUT || pane->tail > 0 )
+		pane->document = false;
+	if (pane->document)
+		pane->markup = pane->ansi = false;
+
+	if ( pane->source == PANE_SOURCE_CLOCK )
+	{
+		if (! init_clock(&pane->clock, pane->app, pane->path))
+			return false;
+		update_clock(pane);
+		return true;
+	}
+	else if ( pane->source == PANE_SOURCE_TEMPLATE )
+	{
+		if (! compile_template(&pane->template, pane->app, pane->path,
+					pane->markup))
+			return false;
+		set_text(pane, pane->template.text, pane->template.len, false);
+		return true;
+	}
+	else if ( pane->source == PANE_SOURCE_WATCH )
+	{
+		if (! init_watch(&pane->file_watch, pane->app, pane->path,
+					pane->app->interval))
+			return false;
+		reload_file(pane);
+		return true;
+	}
+
+	if ( pane->tail > 0 )
+	{
+		pane->tail_lines = calloc(pane->tail, sizeof(char *));
+		pane->tail_lens  = calloc(pane->tail, sizeof(size_t));
+		pane->tail_attrs = calloc(pane->tail, sizeof(PangoAttrList *));
+		if ( pane->tail_lines == NULL || pane->tail_lens == NULL
+				|| pane->tail_attrs == NULL )
+		{
+			printlog(NULL, 0, "ERROR: Could not allocate.\n");
+			return false;
+		}
+	}
+
+	if ( pane->path == NULL )
+	{
+		if ( get_stdin_pane(pane->app) != pane )
+			return true;
+		pane->input.fd = STDIN_FILENO;
+		if (pane->document)
+			return map_document(pane);
+		if (input_map(&pane->input))
+			set_text(pane, pane->input.map, pane->input.map_size, true);
+		return true;
+	}
+
+
+	struct stat st;
+	if ( stat(pane->path, &st) == -1 )
+	{
+		printlog(NULL, 0, "ERROR: Can not open \"%s\": %s\n",
+				pane->path, strerror(errno));
+		return false;
+	}
+
+	/* Keeping a FIFO open for writing as well means it never reports EOF
+	 * when a writer goes away, so writers can come and go.
+	 */
+	int flags = S_ISFIFO(st.st_mode) ? O_RDWR | O_NONBLOCK : O_RDONLY;
+	if ( -1 == (pane->input.fd = open(pane->path, flags | O_CLOEXEC)) )
+	{
+		printlog(NULL, 0, "ERROR: Can not open \"%s\": %s\n",
+				pane->path, strerror(errno));
+		return false;
+	}
+
+	printlog(pane->app, 2, "[pane] Reading \"%s\": name=%s\n",
+			pane->path, pane->name);
+	if (pane->document)
+		return map_document(pane);
+	return true;
+}
+
+/* Counts a record read from an input, which arrived at the given time. A
+ * record replacing one which has not been shown yet is lost, lines added
+ * to a tail are not. Clock ticks, templates and watched files are no
+ * records.
+ */
+static void add_record (struct Draw_pane *pane, uint64_t time)
+{
+	struct App *app = pane->app;
+	app->stats.records++;
+	if ( pane->record_time == 0 )
+		pane->record_time = time;
+	else if ( pane->tail == 0 )
+		app->stats.records_coalesced++;
+}
+
+/* Frames carry their own flags, so they are neither tagged nor limited to
+ * markup, and may extend the current text instead of replacing it. Like a
+ * single payload, appended text is limited to BUFFERSIZE; a frame which
+ * would exceed it replaces the text instead.
+ */
+static void handle_frame (struct Draw_pane *pane, const char *payload, size_t len)
+{
+	uint16_t flags = pane->input.frame_flags;
+	bool markup = flags & FRAME_MARKUP && ! pane->ansi;
+
+	/* A frame may tell when it was sent, which is when the latency of
+	 * showing it starts.
+	 */
+	add_record(pane, flags & FRAME_TIMESTAMP
+			? realtime_to_monotonic(pane->input.frame_timestamp)
+			: monotonic_ns());
+
+	/* ANSI text is appended to the raw text, so the escape sequences of
+	 * both are parsed together.
+	 */
+	const char *prev = pane->ansi && pane->raw != NULL ? pane->raw : pane->text;
+	size_t prev_len  = pane->ansi && pane->raw != NULL ? pane->raw_len : pane->text_len;
+	if ( flags & FRAME_APPEND && prev != NULL && markup == pane->markup
+			&& prev_len + len < BUFFERSIZE )
+	{
+		char *text = malloc(prev_len + len + 1);
+		if ( text == NULL )
+		{
+			printlog(NULL, 0, "ERROR: Could not allocate.\n");
+			return;
+		}
+		memcpy(text, prev, prev_len);
+		memcpy(text + prev_len, payload, len);
+		text[prev_len + len] = '\0';
+		set_text(pane, text, prev_len + len, false);
+		free(text);
+	}
+	else
+	{
+		pane->markup = markup;
+		set_text(pane, payload, len, false);
+	}
+}
+
+static void handle_record (void *data, const char *record, size_t len)
+{
+	struct Draw_pane *pane = (struct Draw_pane *)data;
+
+	if (pane->input.framed)
+	{
+		handle_frame(pane, record, len);
+		return;
+	}
+
+	/* Records on stdin may be tagged with the name of the pane they are
+	 * meant for, followed by a tab.
+	 */
+	const char *tab;
+	if ( pane->source == PANE_SOURCE_INPUT && pane->path == NULL
+			&& NULL != (tab = memchr(record, '\t', len)) )
+	{
+		struct Draw_pane *target;
+		size_t tag_len = (size_t)(tab - record);
+		wl_list_for_each(target, &pane->app->panes, link)
+			if ( target->source == PANE_SOURCE_INPUT
+					&& target->path == NULL && target->name != NULL
+					&& strlen(target->name) == tag_len
+					&& ! strncmp(target->name, record, tag_len) )
+			{
+				add_record(target, monotonic_ns());
+				set_text(target, tab + 1, len - tag_len - 1, false);
+				return;
+			}
+	}
+
+	add_record(pane, monotonic_ns());
+	set_text(pane, record, len, false);
+}
+
+int pane_get_fd (struct Draw_pane *pane)
+{
+	switch (pane->source)
+	{
+		case PANE_SOURCE_WATCH:
+			return pane->file_watch.fd;
+
+		case PANE_SOURCE_CLOCK:
+			return pane->clock.fd;
+
+		case PANE_SOURCE_TEMPLATE:
+			return pane->template.fd;
+
+		default:
+			return pane->input.fd;
+	}
+}
+
+/* Returns true if the fd of the pane is a timer rather than an input, so it
+ * can be ignored while nothing is rendered.
+ */
+bool pane_is_timed (struct Draw_pane *pane)
+{
+	return pane->source == PANE_SOURCE_CLOCK || pane->source == PANE_SOURCE_TEMPLATE
+		|| ( pane->source == PANE_SOURCE_WATCH && pane->file_watch.polling );
+}
+
+/* Returns false once the input of the pane is exhausted. */
+bool pane_read (struct Draw_pane *pane)
+{
+	if ( pane->source == PANE_SOURCE_WATCH )
+	{
+		if (watch_dispatch(&pane->file_watch))
+			reload_file(pane);
+		return true;
+	}
+	else if ( pane->source == PANE_SOURCE_CLOCK )
+	{
+		if (clock_dispatch(&pane->clock))
+			update_clock(pane);
+		return true;
+	}
+	else if ( pane->source == PANE_SOURCE_TEMPLATE )
+	{
+		/* Only rebuilt if any of the values changed. */
+		if (template_dispatch(&pane->template))
+			set_text(pane, pane->template.text, pane->template.len, false);
+		return true;
+	}
+
+	if (pane->document)
+	{
+		/* Only lines which are visible, or up to which the document
+		 * has not been indexed yet, require a new frame.
+		 */
+		bool added, ret = document_read(&pane->doc, pane->input.fd, &added);
+		if ( added && pane->doc.lines <= pane->scroll + pane->document_visible )
+			document_changed(pane);
+		if (! ret)
+		{
+			printlog(pane->app, 2, "[pane] Input closed: name=%s size=%zu\n",
+					pane->name, pane->doc.len);
+			finish_input(&pane->input);
+		}
+		return ret;
+	}
+
+	if (! input_read(&pane->input, handle_record, pane))
+	{
+		printlog(pane->app, 2, "[pane] Input closed: name=%s\n", pane->name);
+		finish_input(&pane->input);
+		return false;
+	}
+	return true;
+}
+
+/* Updates clocks and templates, which show the local time. */
+void pane_timezone_changed (struct Draw_pane *pane)
+{
+	if ( pane->source == PANE_SOURCE_CLOCK )
+	{
+		clock_timezone_changed(&pane->clock);
+		update_clock(pane);
+	}
+	else if ( pane->source == PANE_SOURCE_TEMPLATE
+			&& template_timezone_changed(&pane->template) )
+		set_text(pane, pane->template.text, pane->template.len, false);
+}
+
+void pane_set_text (struct Draw_pane *pane, const char *text, size_t len)
+{
+	set_text(pane, text, len, false);
+}
+
+void pane_set_font (struct Draw_pane *pane, const char *font_pattern)
+{
+	if ( font_pattern != pane->font_pattern )
+		set_string(&pane->font_pattern, (char *)font_pattern);
+	if ( pane->font_description != NULL )
+		pango_font_description_free(pane->font_description);
+	pane->font_description = pango_font_description_from_string(pane->font_pattern);
+	pane_touch(pane, true);
+}
+
+/* Marks the content of the pane as changed. */
+void pane_touch (struct Draw_pane *pane, bool layout)
+{
+	pane->seq = pane->redraw_seq = ++pane->app->seq;
+	if (layout)
+		pane->layout_seq = pane->style_seq = pane->seq;
+	pane->dirty = true;
+}
+
+/* Sets the first line of a document shown, either absolute, relative with
+ * a sign, or "end" for the last lines. Offsets past the end show the last
+ * line.
+ */
+bool pane_scroll (struct Draw_pane *pane, const char *offset)
+{
+	if ( ! pane->document || offset == NULL )
+		return false;
+
+	uint64_t scroll;
+	if (! strcmp(offset, "end"))
+	{
+		uint64_t lines = document_line_count(&pane->doc);
+		scroll = lines > pane->document_visible ? lines - pane->document_visible : 0;
+	}
+	else
+	{
+		char *end;
+		errno = 0;
+		long long value = strtoll(offset, &end, 10);
+		if ( errno != 0 || end == offset || *end != '\0' )
+			return false;
+		if ( *offset == '+' || *offset == '-' )
+			value += (long long)pane->scroll;
+		scroll = value < 0 ? 0 : (uint64_t)value;
+
+		size_t len;
+		if ( scroll > 0 && document_get_line(&pane->doc, scroll, &len) == NULL )
+		{
+			uint64_t lines = document_line_count(&pane->doc);
+			scroll = lines > 0 ? lines - 1 : 0;
+		}
+	}
+
+	printlog(pane->app, 2, "[pane] Scroll: name=%s line=%lu\n",
+			pane->name, (unsigned long)scroll);
+	if ( scroll != pane->scroll )
+	{
+		pane->scroll = scroll;
+		pane_touch(pane, false);
+	}
+	return true;
+}
+
+/* Returns a line of the document or of the tail, or NULL if it is no longer
+ * (or not yet) in the ring. Document lines have no attributes.
+ */
+const char *pane_get_line (struct Draw_pane *pane, uint64_t line, size_t *len,
+		PangoAttrList **attrs)
+{
+	if (pane->document)
+	{
+		*attrs = NULL;
+		return document_get_line(&pane->doc, line, len);
+	}
+	if ( line >= pane->tail_total || pane->tail_total - line > pane->tail )
+		return NULL;
+	size_t slot = (size_t)(line % pane->tail);
+	*len   = pane->tail_lens[slot];
+	*attrs = pane->tail_attrs[slot];
+	return pane->tail_lines[slot];
+}
+
+struct Draw_pane *get_pane_from_name (struct App *app, const char *name)
+{
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+		if ( pane->name != NULL && ! strcmp(pane->name, name) )
+			return pane;
+	return NULL;
+}
+
+void destroy_all_panes (struct App *app)
+{
+	struct Draw_pane *pane, *tmp;
+	wl_list_for_each_safe(pane, tmp, &app->panes, link)
+	{
+		if ( pane->source == PANE_SOURCE_WATCH )
+			finish_watch(&pane->file_watch);
+		else if ( pane->source == PANE_SOURCE_CLOCK )
+			finish_clock(&pane->clock);
+		else if ( pane->source == PANE_SOURCE_TEMPLATE )
+			finish_template(&pane->template);
+		if (! pane->text_borrowed)
+			free_if_set(pane->text);
+		if ( pane->tail_lines != NULL )
+			for (size_t i = 0; i < pane->tail; i++)
+				free_if_set(pane->tail_lines[i]);
+		if ( pane->tail_attrs != NULL )
+			for (size_t i = 0; i < pane->tail; i++)
+				if ( pane->tail_attrs[i] != NULL )
+					pango_attr_list_unref(pane->tail_attrs[i]);
+		if ( pane->attrs != NULL )
+			pango_attr_list_unref(pane->attrs);
+		free_if_set(pane->raw);
+		finish_document(&pane->doc);
+		free_if_set(pane->tail_lines);
+		free_if_set(pane->tail_lens);
+		free_if_set(pane->tail_attrs);
+		finish_input(&pane->input);
+		if ( pane->font_description != NULL )
+			pango_font_description_free(pane->font_description);
+		free_if_set(pane->font_pattern);
+		free_if_set(pane->name);
+		free_if_set(pane->path);
+		wl_list_remove(&pane->link);
+		free(pane);
+	}
+	app->pane = NULL;
+}
@@ -0,0 +1,131 @@
+#ifndef WLCLOCK_PANE_H
+#define WLCLOCK_PANE_H
+
+#include<stdbool.h>
+#include<stdint.h>
+#include<wayland-server.h>
+#include<pango/pangocairo.h>
+
+#include"colour.h"
+#include"input.h"
+#include"watch.h"
+#include"clock.h"
+#include"template.h"
+#include"document.h"
+
+struct App;
+struct Draw_dimensions;
+
+enum Pane_source
+{
+	PANE_SOURCE_INPUT,
+	PANE_SOURCE_WATCH,
+	PANE_SOURCE_CLOCK,
+	PANE_SOURCE_TEMPLATE,
+};
+
+struct Draw_pane
+{
+	struct wl_list  link;
+	struct App     *app;
+
+	char   *name;
+	size_t  index;
+
+	/* Rectangle of the pane, relative to the area inside the border. A
+	 * width or height of 0 extends the pane to the edge of that area.
+	 */
+	int32_t x, y, w, h;
+
+	char                 *font_pattern;
+	PangoFontDescription *font_description;
+	struct Draw_colour    text_colour;
+	struct Draw_colour    background_colour;
+	bool                  wordwrap;
+	bool                  center;
+
+	/* The path of the input file, FIFO or watched file, the format of the
+	 * clock or the template. Input panes without a path read (tagged) records from
+	 * stdin.
+	 */
+	enum Pane_source source;
+	char            *path;
+	struct Input     input;
+	struct Watch     file_watch;
+	struct Clock     clock;
+	struct Template  template;
+
+	/* The text may point into a mapping owned by the input. It is Pango
+	 * markup unless markup is false.
+	 */
+	char   *text;
+	size_t  text_len;
+	bool    text_borrowed;
+	bool    markup;
+
+	/* In ANSI mode, the escape sequences are stripped from the text and
+	 * the SGR ones turned into attrs instead, and the text is never
+	 * markup. The raw text is kept, so appended frames continue with the
+	 * attributes in effect at its end.
+	 */
+	bool           ansi;
+	PangoAttrList *attrs;
+	char          *raw;
+	size_t         raw_len;
+
+	/* In tail mode, the last tail records are kept as lines in a ring,
+	 * indexed by their line number modulo tail. tail_total counts all lines
+	 * ever added.
+	 */
+	size_t          tail;
+	char          **tail_lines;
+	size_t         *tail_lens;
+	PangoAttrList **tail_attrs;
+	uint64_t        tail_total;
+
+	/* In document mode, the input is kept as a document, of which only
+	 * the lines from scroll on that fit into the pane are shown. The
+	 * number of lines that fit on the largest output is set when drawing.
+	 */
+	bool            document;
+	struct Document doc;
+	uint64_t        scroll;
+	uint64_t        document_visible;
+
+	/* Value of app->seq when the content of the pane last changed, and
+	 * when it last changed in a way requiring a new layout. A change of
+	 * colour for example only requires the former. Adding a line to the
+	 * tail changes neither layout_seq nor redraw_seq, so the lines already
+	 * drawn can be scrolled instead. A new text changes only layout_seq,
+	 * so unchanged lines can be kept, while style_seq changes whenever
+	 * something else changes the layout, like the font.
+	 */
+	uint64_t seq;
+	uint64_t layout_seq;
+	uint64_t redraw_seq;
+	uint64_t style_seq;
+	bool     dirty;
+
+	/* Arrival time of the oldest record not committed yet, or 0. */
+	uint64_t record_time;
+};
+
+struct Draw_pane *create_pane (struct App *app, const char *name);
+bool pane_set_geometry (struct Draw_pane *pane, const char *str);
+void pane_get_rect (struct Draw_pane *pane, struct Draw_dimensions *dimensions,
+		int32_t *x, int32_t *y, int32_t *w, int32_t *h);
+bool init_pane (struct Draw_pane *pane);
+int pane_get_fd (struct Draw_pane *pane);
+bool pane_is_timed (struct Draw_pane *pane);
+bool pane_read (struct Draw_pane *pane);
+void pane_set_text (struct Draw_pane *pane, const char *text, size_t len);
+void pane_timezone_changed (struct Draw_pane *pane);
+void pane_set_font (struct Draw_pane *pane, const char *font_pattern);
+void pane_touch (struct Draw_pane *pane, bool layout);
+bool pane_scroll (struct Draw_pane *pane, const char *offset);
+const char *pane_get_line (struct Draw_pane *pane, uint64_t line, size_t *len,
+		PangoAttrList **attrs);
+struct Draw_pane *get_pane_from_name (struct App *app, const char *name);
+void destroy_all_panes (struct App *app);
+
+#endif
@@ -0,0 +1,149 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<time.h>
+
+#include<wayland-client.h>
+
+#include"presentation-time-protocol.h"
+
+#include"wayout.h"
+#include"misc.h"
+#include"surface.h"
+#include"presentation.h"
+
+/* A frame showing at least one record, waiting for the compositor to tell
+ * when it hit the screen. All times are on the monotonic clock.
+ */
+struct Feedback
+{
+	struct wl_list                   link;
+	struct App                      *app;
+	struct wp_presentation_feedback *feedback;
+
+	uint64_t record_time;
+	uint64_t render_start;
+	uint64_t committed;
+};
+
+static void presentation_handle_clock_id (void *data,
+		struct wp_presentation *presentation, uint32_t clock_id)
+{
+	struct App *app = (struct App *)data;
+	printlog(app, 2, "[presentation] Clock: %u\n", clock_id);
+	app->presentation_clock = (clockid_t)clock_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+	.clock_id = presentation_handle_clock_id,
+};
+
+void init_presentation (struct App *app, struct wl_registry *registry, uint32_t name)
+{
+	app->presentation_clock = CLOCK_MONOTONIC;
+	app->presentation = wl_registry_bind(registry, name,
+			&wp_presentation_interface, 1);
+	wp_presentation_add_listener(app->presentation, &presentation_listener, app);
+}
+
+static void destroy_feedback (struct Feedback *feedback)
+{
+	wl_list_remove(&feedback->link);
+	wp_presentation_feedback_destroy(feedback->feedback);
+	free(feedback);
+}
+
+static void feedback_handle_sync_output (void *data,
+		struct wp_presentation_feedback *wp_feedback, struct wl_output *output)
+{
+	/* Unused. */
+}
+
+/* Converts a timestamp of the presentation clock to the monotonic clock. */
+static uint64_t to_monotonic (struct App *app, uint64_t time)
+{
+	if ( app->presentation_clock == CLOCK_MONOTONIC )
+		return time;
+	struct timespec ts;
+	clock_gettime(app->presentation_clock, &ts);
+	uint64_t now = (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+	return time + monotonic_ns() - now;
+}
+
+static void feedback_handle_presented (void *data,
+		struct wp_presentation_feedback *wp_feedback,
+		uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+		uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags)
+{
+	struct Feedback *feedback = (struct Feedback *)data;
+	struct Stats    *stats    = &feedback->app->stats;
+
+	uint64_t sec = ((uint64_t)tv_sec_hi << 32) | tv_sec_lo;
+	uint64_t presented = to_monotonic(feedback->app,
+			sec * 1000000000 + tv_nsec);
+
+	/* The clocks may disagree slightly, never report negative times. */
+	if ( presented < feedback->committed )
+		presented = feedback->committed;
+
+	stats->frames_presented++;
+	histogram_add(&stats->photon, presented - feedback->record_time);
+	histogram_add(&stats->queueing, feedback->render_start - feedback->record_time);
+	histogram_add(&stats->render, feedback->committed - feedback->render_start);
+	histogram_add(&stats->compositor, presented - feedback->committed);
+
+	destroy_feedback(feedback);
+}
+
+static void feedback_handle_discarded (void *data,
+		struct wp_presentation_feedback *wp_feedback)
+{
+	struct Feedback *feedback = (struct Feedback *)data;
+	feedback->app->stats.frames_discarded++;
+	destroy_feedback(feedback);
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+	.sync_output = feedback_handle_sync_output,
+	.presented   = feedback_handle_presented,
+	.discarded   = feedback_handle_discarded,
+};
+
+/* Asks for feedback on the commit of the text surface about to happen,
+ * which shows a record which arrived at record_time and started rendering
+ * at render_start.
+ */
+void request_presentation_feedback (struct Draw_surface *surface,
+		uint64_t record_time, uint64_t render_start)
+{
+	struct App *app = surface->app;
+	if ( app->presentation == NULL )
+		return;
+
+	struct Feedback *feedback = calloc(1, sizeof(struct Feedback));
+	if ( feedback == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return;
+	}
+	feedback->app          = app;
+	feedback->record_time  = record_time;
+	feedback->render_start = render_start;
+	feedback->committed    = monotonic_ns();
+	feedback->feedback     = wp_presentation_feedback(app->presentation,
+			surface->text_surface);
+	wp_presentation_feedback_add_listener(feedback->feedback,
+			&feedback_listener, feedback);
+	wl_list_insert(&app->presentation_feedbacks, &feedback->link);
+}
+
+void finish_presentation (struct App *app)
+{
+	struct Feedback *feedback, *tmp;
+	wl_list_for_each_safe(feedback, tmp, &app->presentation_feedbacks, link)
+		destroy_feedback(feedback);
+	if ( app->presentation != NULL )
+		wp_presentation_destroy(app->presentation);
+	app->presentation = NULL;
+}
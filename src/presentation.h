@@ -0,0 +1,14 @@
+#ifndef WLCLOCK_PRESENTATION_H
+#define WLCLOCK_PRESENTATION_H
+
+#include<stdint.h>
+
+struct App;
+struct Draw_surface;
+
+void init_presentation (struct App *app, struct wl_registry *registry, uint32_t name);
+void request_presentation_feedback (struct Draw_surface *surface,
+		uint64_t record_time, uint64_t render_start);
+void finish_presentation (struct App *app);
+
+#endif
@@ -17,6 +17,8 @@
 #include"misc.h"
 #include"colour.h"
 #include"render.h"
+#include"pane.h"
+#include"trace.h"
 
 #define PI 3.141592653589793238462643383279502884
 
@@ -38,6 +40,7 @@ static void draw_background (cairo_t *cairo, struct Draw_dimensions *dimensions,
 	if ( colour_is_transparent(&app->background_colour)
 			&& colour_is_transparent(&app->border_colour) )
 		return;
+	TRACE_BEGIN(draw_background);
 
 	int32_t w                   = scale * dimensions->w;
 	int32_t h                   = scale * dimensions->h;
@@ -97,47 +100,94 @@ static void draw_background (cairo_t *cairo, struct Draw_dimensions *dimensions,
 	}
 
 	cairo_restore(cairo);
+	TRACE_END(draw_background);
 }
 
-static void draw_main (cairo_t *cairo, PangoLayout *layout, PangoFontDescription * font_description, struct Draw_dimensions *dimensions,
-		int32_t scale, struct App *app)
+/* Returns the Pango context shared by all layouts, creating it first if
+ * necessary.
+ */
+PangoContext *get_pango_context (struct App *app)
+{
+	if ( app->pango_context == NULL )
+		app->pango_context = pango_font_map_create_context(
+				pango_cairo_font_map_get_default());
+	return app->pango_context;
+}
+
+static void record_layout_time (struct App *app, uint64_t start)
+{
+	uint64_t end = monotonic_ns(), time = end - start;
+	TRACE_RECORD("layout", start, end);
+	histogram_add(&app->stats.layout, time);
+	app->stats.frame_layout += time;
+}
+
+/* Returns the layout of the pane, which is only re-shaped if the text, the
+ * font or the available width changed since it was last used.
+ */
+static PangoLayout *get_layout (struct Draw_surface *surface,
+		struct Draw_pane *pane, int32_t w)
+{
+	struct App *app = pane->app;
+	struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+
+	if ( cache->layout != NULL && cache->layout_seq == pane->layout_seq
+			&& cache->width == w )
+		return cache->layout;
+
+	printlog(app, 2, "[render] Layout pane: name=%s\n", pane->name);
+	uint64_t start = monotonic_ns();
+
+	if ( cache->layout == NULL )
+		cache->layout = pango_layout_new(get_pango_context(app));
+
+	PangoLayout *layout = cache->layout;
+	pango_layout_set_font_description(layout, pane->font_description);
+	if (pane->wordwrap) {
+		pango_layout_set_width (layout, w * PANGO_SCALE);
+		pango_layout_set_wrap (layout, PANGO_WRAP_WORD);
+	}
+	if (pane->center) pango_layout_set_alignment(layout, PANGO_ALIGN_CENTER);
+	/* The layout is reused, so the attributes set by earlier markup
+	 * have to be replaced for plain text.
+	 */
+	if (pane->markup)
+		pango_layout_set_markup(layout, pane->text, (int)pane->text_len);
+	else
+	{
+		pango_layout_set_text(layout, pane->text, (int)pane->text_len);
+		pango_layout_set_attributes(layout, pane->ansi ? pane->attrs : NULL);
+	}
+
+	/* Pango lays out lazily, so force it here to time it. */
+	pango_layout_get_line_count(layout);
+	record_layout_time(app, start);
+
+	cache->layout_seq = pane->layout_seq;
+	cache->width      = w;
+	return layout;
+}
+
+static void draw_main (cairo_t *cairo, PangoLayout *layout, struct Draw_pane *pane,
+		int32_t x, int32_t y, int32_t w, int32_t h, struct App *app)
 {
+	TRACE_BEGIN(draw_main);
 	cairo_save(cairo);
 
-	cairo_set_source_rgba (
-		cairo,
-		app->text_colour.r,
-		app->text_colour.g,
-		app->text_colour.b,
-		app->text_colour.a
-	);
-	int32_t w = app->dimensions.w * scale;
-	int32_t h = app->dimensions.h * scale;
-	if (app->text) {
-		printlog(app, 2, "Outputting text: %s\n", app->text);
-		cairo_move_to(cairo, w / 2.0, h / 2.0);
-		pango_layout_set_font_description(layout, font_description);
-		if (app->center) pango_layout_set_alignment(layout, PANGO_ALIGN_CENTER);
-		
-		time_t current_time;
-		struct tm * time_info;
-		char timeString[9];
-		time(&current_time);
-		time_info = localtime(&current_time);
-		strftime(timeString, 9, "%H:%M:%S", time_info);
-		pango_layout_set_markup(layout, timeString, -1);
+	colour_set_cairo_source(cairo, &pane->text_colour);
 
+	printlog(app, 2, "Outputting text: %.*s\n", (int)pane->text_len, pane->text);
+	if (pane->center) {
+		cairo_move_to(cairo, x, y);
+	} else {
 		int width, height;
 		pango_layout_get_size(layout, &width, &height);
-
-		if (app->center) {
-			cairo_rel_move_to(cairo, - w / 2.0, - h / 2.0);
-		} else {
-			cairo_rel_move_to(cairo, - ((double)width / PANGO_SCALE) / 2, - ((double)height / PANGO_SCALE) / 2);
-		}
+		cairo_move_to(cairo, x + (w - (double)width / PANGO_SCALE) / 2,
+				y + (h - (double)height / PANGO_SCALE) / 2);
 	}
 	pango_cairo_show_layout(cairo, layout);
 	cairo_restore(cairo);
+	TRACE_END(draw_main);
 }
 
 static void clear_buffer (cairo_t *cairo)
@@ -148,7 +198,616 @@ static void clear_buffer (cairo_t *cairo)
 	cairo_restore(cairo);
 }
 
-void render_background_frame (struct Draw_surface *surface)
+void drop_tail_cache (struct Draw_pane_cache *cache)
+{
+	if ( cache->tail_layouts == NULL )
+		return;
+	for (size_t i = 0; i < cache->tail_slots; i++)
+		if ( cache->tail_layouts[i] != NULL )
+			g_object_unref(cache->tail_layouts[i]);
+	free(cache->tail_layouts);
+	free(cache->tail_shaped);
+	cache->tail_layouts = NULL;
+	cache->tail_shaped  = NULL;
+	cache->tail_slots   = 0;
+}
+
+/* A tail needs a slot for each line of the ring, a document one for each
+ * line that fits into the pane, plus one partially visible at the bottom.
+ */
+static size_t get_tail_slots (struct Draw_pane *pane, int32_t line_height, int32_t h)
+{
+	return pane->tail > 0 ? pane->tail : (size_t)(h / line_height) + 2;
+}
+
+/* Prepares the line cache of a tail or document pane. Lines are shaped
+ * individually and share a fixed height, so they can be moved around as
+ * pixels. Returns false if the cache had to be reset.
+ */
+static bool prepare_tail (struct Draw_surface *surface, struct Draw_pane *pane,
+		int32_t w, int32_t h)
+{
+	struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+
+	if ( cache->tail_layouts != NULL && cache->layout_seq == pane->layout_seq
+			&& cache->width == w
+			&& cache->tail_slots == get_tail_slots(pane, cache->line_height, h) )
+		return true;
+
+	PangoFontMetrics *metrics = pango_context_get_metrics(get_pango_context(pane->app),
+			pane->font_description, NULL);
+	cache->line_height = PANGO_PIXELS_CEIL(pango_font_metrics_get_ascent(metrics)
+			+ pango_font_metrics_get_descent(metrics));
+	pango_font_metrics_unref(metrics);
+	if ( cache->line_height < 1 )
+		cache->line_height = 1;
+
+	size_t slots = get_tail_slots(pane, cache->line_height, h);
+	if ( cache->tail_slots != slots )
+		drop_tail_cache(cache);
+	if ( cache->tail_layouts == NULL )
+	{
+		cache->tail_layouts = calloc(slots, sizeof(PangoLayout *));
+		cache->tail_shaped  = calloc(slots, sizeof(uint64_t));
+		if ( cache->tail_layouts == NULL || cache->tail_shaped == NULL )
+		{
+			printlog(NULL, 0, "ERROR: Could not allocate.\n");
+			free_if_set(cache->tail_layouts);
+			free_if_set(cache->tail_shaped);
+			cache->tail_layouts = NULL;
+			cache->tail_shaped  = NULL;
+			return false;
+		}
+		cache->tail_slots = slots;
+	}
+
+	memset(cache->tail_shaped, 0, slots * sizeof(uint64_t));
+	cache->layout_seq = pane->layout_seq;
+	cache->width      = w;
+	return false;
+}
+
+/* Returns the layout of a line of the tail or document, which is only
+ * shaped once as long as it stays in its slot.
+ */
+static PangoLayout *get_tail_layout (struct Draw_surface *surface,
+		struct Draw_pane *pane, uint64_t line)
+{
+	struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+	size_t slot = (size_t)(line % cache->tail_slots);
+	size_t len;
+	PangoAttrList *attrs;
+	const char *text = pane_get_line(pane, line, &len, &attrs);
+	if ( text == NULL )
+		return NULL;
+
+	if ( cache->tail_layouts[slot] != NULL && cache->tail_shaped[slot] == line + 1 )
+		return cache->tail_layouts[slot];
+
+	printlog(pane->app, 3, "[render] Layout tail line: name=%s line=%lu\n",
+			pane->name, (unsigned long)line);
+
+	uint64_t start = monotonic_ns();
+	if ( cache->tail_layouts[slot] == NULL )
+		cache->tail_layouts[slot] = pango_layout_new(get_pango_context(pane->app));
+	PangoLayout *layout = cache->tail_layouts[slot];
+	pango_layout_set_font_description(layout, pane->font_description);
+	if (pane->markup)
+		pango_layout_set_markup(layout, text, (int)len);
+	else
+	{
+		pango_layout_set_text(layout, text, (int)len);
+		pango_layout_set_attributes(layout, pane->ansi ? attrs : NULL);
+	}
+	pango_layout_get_line_count(layout);
+	record_layout_time(pane->app, start);
+	cache->tail_shaped[slot] = line + 1;
+	return layout;
+}
+
+/* Draws the lines of the tail starting at first. The newest line is at the
+ * bottom of the pane, each line above it one line height further up.
+ */
+static void draw_tail (cairo_t *cairo, struct Draw_surface *surface,
+		struct Draw_pane *pane, int32_t x, int32_t y, int32_t h, uint64_t first)
+{
+	struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+	uint64_t visible = (uint64_t)(h + cache->line_height - 1) / (uint64_t)cache->line_height;
+	if ( pane->tail_total > visible && first < pane->tail_total - visible )
+		first = pane->tail_total - visible;
+
+	cairo_save(cairo);
+	colour_set_cairo_source(cairo, &pane->text_colour);
+	for (uint64_t line = first; line < pane->tail_total; line++)
+	{
+		PangoLayout *layout = get_tail_layout(surface, pane, line);
+		if ( layout == NULL )
+			continue;
+		cairo_move_to(cairo, x, y + h
+				- (double)(pane->tail_total - line) * cache->line_height);
+		pango_cairo_show_layout(cairo, layout);
+	}
+	cairo_restore(cairo);
+}
+
+/* Draws the lines of a document from the scroll offset down, as many as
+ * fit into the pane. Only these lines are ever laid out.
+ */
+static void draw_document (cairo_t *cairo, struct Draw_surface *surface,
+		struct Draw_pane *pane, int32_t x, int32_t y, int32_t h)
+{
+	struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+	uint64_t visible = (uint64_t)(h + cache->line_height - 1) / (uint64_t)cache->line_height;
+	if ( visible > pane->document_visible )
+		pane->document_visible = visible;
+
+	printlog(pane->app, 2, "[render] Draw document: name=%s first=%lu lines=%lu\n",
+			pane->name, (unsigned long)pane->scroll, (unsigned long)visible);
+
+	cairo_save(cairo);
+	colour_set_cairo_source(cairo, &pane->text_colour);
+	for (uint64_t i = 0; i < visible; i++)
+	{
+		PangoLayout *layout = get_tail_layout(surface, pane, pane->scroll + i);
+		if ( layout == NULL )
+			break;
+		cairo_move_to(cairo, x, y + (double)i * cache->line_height);
+		pango_cairo_show_layout(cairo, layout);
+	}
+	cairo_restore(cairo);
+}
+
+/* Gets the rectangle of the pane in the text buffer, which starts at the
+ * inner edge of the border, in buffer coordinates (scaled).
+ */
+static void get_buffer_rect (struct Draw_surface *surface, struct Draw_pane *pane,
+		int32_t scale, int32_t *x, int32_t *y, int32_t *w, int32_t *h)
+{
+	int32_t area_x, area_y, area_w, area_h;
+	get_text_area(surface, &area_x, &area_y, &area_w, &area_h);
+	pane_get_rect(pane, &surface->dimensions, x, y, w, h);
+	*x = (*x - area_x) * scale;
+	*y = (*y - area_y) * scale;
+	*w *= scale;
+	*h *= scale;
+}
+
+/* Draws a single pane. Unless the entire buffer has just been cleared, the
+ * rectangle of the pane is cleared first, revealing the background of the
+ * parent surface.
+ */
+static void draw_pane (cairo_t *cairo, struct Draw_surface *surface,
+		struct Draw_pane *pane, int32_t scale, bool full)
+{
+	struct App *app = pane->app;
+	int32_t x, y, w, h;
+	get_buffer_rect(surface, pane, scale, &x, &y, &w, &h);
+
+	cairo_save(cairo);
+	cairo_rectangle(cairo, x, y, w, h);
+	cairo_clip(cairo);
+
+	if (! full)
+		clear_buffer(cairo);
+
+	if (! colour_is_transparent(&pane->background_colour))
+	{
+		cairo_rectangle(cairo, x, y, w, h);
+		colour_set_cairo_source(cairo, &pane->background_colour);
+		cairo_fill(cairo);
+	}
+
+	if ( pane->tail > 0 || pane->document )
+	{
+		bool prepared = prepare_tail(surface, pane, w, h)
+			|| surface->pane_caches[pane->index].tail_layouts != NULL;
+		if ( prepared && pane->document )
+			draw_document(cairo, surface, pane, x, y, h);
+		else if (prepared)
+			draw_tail(cairo, surface, pane, x, y, h, 0);
+	}
+	else if ( pane->text != NULL )
+		draw_main(cairo, get_layout(surface, pane, w), pane, x, y, w, h, app);
+
+	cairo_restore(cairo);
+}
+
+/* Updates a tail pane by moving the pixels of the lines already shown in
+ * the last committed frame up, so only the band of the new lines at the
+ * bottom has to be rasterised. Returns false if that is not possible and
+ * the pane has to be redrawn instead.
+ */
+static bool scroll_tail (cairo_t *cairo, struct Draw_surface *surface,
+		struct Draw_pane *pane, struct Draw_buffer *prev,
+		struct Draw_buffer *buffer, int32_t scale)
+{
+	struct App *app = pane->app;
+	struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+	int32_t x, y, w, h;
+	get_buffer_rect(surface, pane, scale, &x, &y, &w, &h);
+
+	if ( prev == NULL || prev->buffer == NULL || prev->seq != surface->committed_seq
+			|| prev->w != buffer->w || prev->h != buffer->h
+			|| pane->redraw_seq > surface->committed_seq
+			|| ! prepare_tail(surface, pane, w, h) )
+		return false;
+
+	uint64_t added = pane->tail_total - cache->tail_total;
+	if ( added >= (uint64_t)(h / cache->line_height) )
+		return false;
+	int32_t shift = (int32_t)added * cache->line_height;
+
+	printlog(app, 2, "[render] Scroll tail: name=%s lines=%lu\n",
+			pane->name, (unsigned long)added);
+
+	/* Rows are copied top to bottom, which is safe even if the buffer
+	 * is the one last committed, as rows are only ever moved up.
+	 */
+	cairo_surface_flush(buffer->surface);
+	int stride = cairo_image_surface_get_stride(buffer->surface);
+	unsigned char *dst = cairo_image_surface_get_data(buffer->surface);
+	unsigned char *src = cairo_image_surface_get_data(prev->surface);
+	for (int32_t row = y; row < y + h - shift; row++)
+		memmove(dst + row * stride + x * 4,
+				src + (row + shift) * stride + x * 4, (size_t)w * 4);
+	cairo_surface_mark_dirty_rectangle(buffer->surface, x, y, w, h - shift);
+
+	if ( shift == 0 )
+		return true;
+
+	cairo_save(cairo);
+	cairo_rectangle(cairo, x, y + h - shift, w, shift);
+	cairo_clip(cairo);
+	clear_buffer(cairo);
+	if (! colour_is_transparent(&pane->background_colour))
+	{
+		cairo_rectangle(cairo, x, y, w, h);
+		colour_set_cairo_source(cairo, &pane->background_colour);
+		cairo_fill(cairo);
+	}
+	draw_tail(cairo, surface, pane, x, y, h, cache->tail_total);
+	cairo_restore(cairo);
+	return true;
+}
+
+/* Whether the text of the pane can be laid out line by line with the same
+ * result as a single layout: it has more than one line, is neither a tail
+ * nor ANSI, the lines are not centered relative to each other and its
+ * markup, if any, does not have an element spanning lines.
+ */
+static bool use_lines (struct Draw_pane *pane)
+{
+	if ( pane->text == NULL || pane->tail > 0 || pane->ansi
+			|| ( pane->center && ! pane->wordwrap )
+			|| memchr(pane->text, '\n', pane->text_len) == NULL )
+		return false;
+	if (! pane->markup)
+		return true;
+
+	int depth = 0;
+	for (size_t i = 0; i < pane->text_len; i++)
+	{
+		char c = pane->text[i];
+		if ( c == '\n' && depth != 0 )
+			return false;
+		if ( c != '<' )
+			continue;
+		const char *end = memchr(pane->text + i, '>', pane->text_len - i);
+		if ( end == NULL )
+			return false;
+		if ( pane->text[i+1] == '/' )
+			depth--;
+		else if ( end[-1] != '/' )
+			depth++;
+		i = (size_t)(end - pane->text);
+	}
+	return true;
+}
+
+static uint64_t hash_line (const char *str, size_t len, bool markup)
+{
+	/* FNV-1a */
+	uint64_t hash = markup ? 0xcbf29ce484222325 : 0x84222325cbf29ce4;
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ (uint8_t)str[i]) * 0x100000001b3;
+	return hash;
+}
+
+static void free_lines (struct Draw_line *lines, size_t count)
+{
+	if ( lines == NULL )
+		return;
+	for (size_t i = 0; i < count; i++)
+		if ( lines[i].layout != NULL )
+			g_object_unref(lines[i].layout);
+	free(lines);
+}
+
+void drop_line_cache (struct Draw_pane_cache *cache)
+{
+	free_lines(cache->lines, cache->line_count);
+	cache->lines       = NULL;
+	cache->line_count  = 0;
+	cache->lines_drawn = false;
+}
+
+static PangoLayout *get_line_layout (struct Draw_pane *pane, const char *text,
+		size_t len, int32_t w)
+{
+	uint64_t start = monotonic_ns();
+	PangoLayout *layout = pango_layout_new(get_pango_context(pane->app));
+	pango_layout_set_font_description(layout, pane->font_description);
+	if (pane->wordwrap) {
+		pango_layout_set_width (layout, w * PANGO_SCALE);
+		pango_layout_set_wrap (layout, PANGO_WRAP_WORD);
+	}
+	if (pane->center) pango_layout_set_alignment(layout, PANGO_ALIGN_CENTER);
+	if (pane->markup)
+		pango_layout_set_markup(layout, text, (int)len);
+	else
+	{
+		pango_layout_set_text(layout, text, (int)len);
+		pango_layout_set_attributes(layout, NULL);
+	}
+	pango_layout_get_line_count(layout);
+	record_layout_time(pane->app, start);
+	return layout;
+}
+
+/* Splits the text into lines, taking the layouts of lines which did not
+ * change from the old lines and setting from to the index of the old line,
+ * or -1. Also gets the position of the first line, placed like
+ * draw_main() places the whole text. Returns NULL on failure.
+ */
+static struct Draw_line *split_lines (struct Draw_pane_cache *cache,
+		struct Draw_pane *pane, bool reuse, int32_t x, int32_t y,
+		int32_t w, int32_t h, size_t *count, ssize_t **from,
+		int32_t *lines_x, int32_t *lines_y, int32_t *lines_h)
+{
+	*count = 1;
+	for (const char *nl = pane->text; NULL != (nl = memchr(nl,
+					'\n', pane->text_len - (size_t)(nl - pane->text))); nl++)
+		(*count)++;
+
+	struct Draw_line *lines = calloc(*count, sizeof(struct Draw_line));
+	*from = calloc(*count, sizeof(ssize_t));
+	if ( lines == NULL || *from == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		free_if_set(lines);
+		free_if_set(*from);
+		return NULL;
+	}
+
+	int32_t width = 0, height = 0;
+	const char *line = pane->text, *end = pane->text + pane->text_len;
+	for (size_t i = 0; i < *count; i++)
+	{
+		const char *nl = memchr(line, '\n', (size_t)(end - line));
+		size_t len = nl == NULL ? (size_t)(end - line) : (size_t)(nl - line);
+		lines[i].hash = hash_line(line, len, pane->markup);
+
+		/* Lines usually stay where they were or move by a few. */
+		(*from)[i] = -1;
+		for (size_t j = 0; reuse && j < cache->line_count; j++)
+		{
+			size_t k = (i + j) % cache->line_count;
+			if ( cache->lines[k].layout != NULL
+					&& cache->lines[k].hash == lines[i].hash )
+			{
+				lines[i].layout = cache->lines[k].layout;
+				cache->lines[k].layout = NULL;
+				(*from)[i] = (ssize_t)k;
+				break;
+			}
+		}
+		if ( lines[i].layout == NULL )
+			lines[i].layout = get_line_layout(pane, line, len, w);
+
+		int line_w, line_h;
+		pango_layout_get_pixel_size(lines[i].layout, &line_w, &line_h);
+		lines[i].y = height;
+		lines[i].h = line_h;
+		height += line_h;
+		if ( line_w > width )
+			width = line_w;
+		line = nl + 1;
+	}
+
+	if (pane->center)
+		*lines_x = x, *lines_y = y;
+	else
+		*lines_x = x + (w - width) / 2, *lines_y = y + (h - height) / 2;
+	for (size_t i = 0; i < *count; i++)
+		lines[i].y += *lines_y;
+	*lines_h = height;
+	return lines;
+}
+
+static void add_line_damage (struct Draw_pane_cache *cache, int32_t y, int32_t h,
+		int32_t pane_y, int32_t pane_h)
+{
+	if ( y < pane_y )
+		h -= pane_y - y, y = pane_y;
+	if ( y + h > pane_y + pane_h )
+		h = pane_y + pane_h - y;
+	if ( h <= 0 )
+		return;
+
+	/* Adjacent bands are merged, too many damage the entire pane. */
+	size_t n = cache->lines_damage_count;
+	if ( n > 0 && cache->lines_damage[n-1][0] + cache->lines_damage[n-1][1] == y )
+		cache->lines_damage[n-1][1] += h;
+	else if ( n < LINE_DAMAGE_MAX )
+	{
+		cache->lines_damage[n][0] = y;
+		cache->lines_damage[n][1] = h;
+		cache->lines_damage_count++;
+	}
+	else
+		cache->lines_damage_count = 0;
+}
+
+/* Clears the band of the pane and fills it with the pane background. */
+static void clear_band (cairo_t *cairo, struct Draw_pane *pane,
+		int32_t x, int32_t y, int32_t w, int32_t h)
+{
+	cairo_save(cairo);
+	cairo_rectangle(cairo, x, y, w, h);
+	cairo_clip(cairo);
+	clear_buffer(cairo);
+	if (! colour_is_transparent(&pane->background_colour))
+	{
+		colour_set_cairo_source(cairo, &pane->background_colour);
+		cairo_paint(cairo);
+	}
+	cairo_restore(cairo);
+}
+
+static void copy_rows (struct Draw_buffer *dst, struct Draw_buffer *src,
+		int32_t x, int32_t w, int32_t dst_y, int32_t src_y, int32_t h)
+{
+	cairo_surface_flush(dst->surface);
+	int stride = cairo_image_surface_get_stride(dst->surface);
+	unsigned char *dst_data = cairo_image_surface_get_data(dst->surface);
+	unsigned char *src_data = cairo_image_surface_get_data(src->surface);
+	for (int32_t row = 0; row < h; row++)
+		memcpy(dst_data + (dst_y + row) * stride + x * 4,
+				src_data + (src_y + row) * stride + x * 4, (size_t)w * 4);
+	cairo_surface_mark_dirty_rectangle(dst->surface, x, dst_y, w, h);
+}
+
+/* Draws a multi-line text line by line. Unless the pane has to be drawn
+ * entirely, lines which did not change are taken from the last committed
+ * frame, moved if their position changed, and only the other lines are
+ * rasterised. Returns false if the pane has to be drawn by draw_pane().
+ */
+static bool draw_lines (cairo_t *cairo, struct Draw_surface *surface,
+		struct Draw_pane *pane, struct Draw_buffer *prev,
+		struct Draw_buffer *buffer, int32_t scale, bool full)
+{
+	struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+	if (! use_lines(pane))
+	{
+		drop_line_cache(cache);
+		return false;
+	}
+
+	int32_t x, y, w, h;
+	get_buffer_rect(surface, pane, scale, &x, &y, &w, &h);
+	bool reuse = cache->lines_style_seq == pane->style_seq && cache->lines_width == w;
+
+	size_t count;
+	ssize_t *from;
+	int32_t lines_x, lines_y, lines_h;
+	struct Draw_line *lines = split_lines(cache, pane, reuse, x, y, w, h,
+			&count, &from, &lines_x, &lines_y, &lines_h);
+	if ( lines == NULL )
+	{
+		drop_line_cache(cache);
+		return false;
+	}
+
+	/* Pixels can only be reused from the last committed frame, and only
+	 * moved if that is not the buffer drawn to, as bands may overlap.
+	 */
+	bool partial = ! full && reuse && cache->lines_drawn && lines_x == cache->lines_x
+		&& prev != NULL && prev->buffer != NULL && prev->seq == surface->committed_seq
+		&& prev->w == buffer->w && prev->h == buffer->h
+		&& pane->redraw_seq <= surface->committed_seq;
+	for (size_t i = 0; partial && i < count; i++)
+		if ( from[i] >= 0 && cache->lines[from[i]].y != lines[i].y )
+		{
+			struct Draw_line *old = &cache->lines[from[i]];
+			partial = prev != buffer && old->y >= y && old->y + old->h <= y + h;
+		}
+
+	TRACE_BEGIN(draw_lines);
+	cairo_save(cairo);
+	cairo_rectangle(cairo, x, y, w, h);
+	cairo_clip(cairo);
+
+	cache->lines_damage_count = 0;
+	if (partial)
+	{
+		printlog(pane->app, 2, "[render] Draw changed lines: name=%s\n", pane->name);
+		if ( prev != buffer )
+			copy_rows(buffer, prev, x, w, y, y, h);
+
+		/* Rows covered before but not anymore. */
+		int32_t old_end = cache->lines_y + cache->lines_h;
+		if ( cache->lines_y < lines_y )
+		{
+			int32_t end = old_end < lines_y ? old_end : lines_y;
+			clear_band(cairo, pane, x, cache->lines_y, w, end - cache->lines_y);
+			add_line_damage(cache, cache->lines_y, end - cache->lines_y, y, h);
+		}
+		if ( old_end > lines_y + lines_h )
+		{
+			int32_t start = cache->lines_y > lines_y + lines_h ? cache->lines_y
+				: lines_y + lines_h;
+			clear_band(cairo, pane, x, start, w, old_end - start);
+			add_line_damage(cache, start, old_end - start, y, h);
+		}
+	}
+	else
+		clear_band(cairo, pane, x, y, w, h);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		struct Draw_line *line = &lines[i];
+		if (partial)
+		{
+			if ( from[i] >= 0 )
+			{
+				struct Draw_line *old = &cache->lines[from[i]];
+				if ( old->y == line->y )
+					continue;
+				int32_t top = line->y < y ? y : line->y;
+				int32_t bottom = line->y + line->h > y + h ? y + h : line->y + line->h;
+				if ( bottom > top )
+				{
+					copy_rows(buffer, prev, x, w, top, old->y + top - line->y,
+							bottom - top);
+					add_line_damage(cache, top, bottom - top, y, h);
+				}
+				continue;
+			}
+			clear_band(cairo, pane, x, line->y, w, line->h);
+			add_line_damage(cache, line->y, line->h, y, h);
+		}
+		colour_set_cairo_source(cairo, &pane->text_colour);
+		cairo_move_to(cairo, lines_x, line->y);
+		pango_cairo_show_layout(cairo, line->layout);
+	}
+	cairo_restore(cairo);
+	TRACE_END(draw_lines);
+
+	/* Nothing visible changed, so nothing is damaged. */
+	if ( partial && cache->lines_damage_count == 0 )
+	{
+		cache->lines_damage[0][0] = y;
+		cache->lines_damage[0][1] = 0;
+		cache->lines_damage_count = 1;
+	}
+
+	free_lines(cache->lines, cache->line_count);
+	free(from);
+	cache->lines           = lines;
+	cache->line_count      = count;
+	cache->lines_style_seq = pane->style_seq;
+	cache->lines_width     = w;
+	cache->lines_x         = lines_x;
+	cache->lines_y         = lines_y;
+	cache->lines_h         = lines_h;
+	cache->lines_drawn     = true;
+	return true;
+}
+
+/* Renders the border and background to the parent surface. Returns false
+ * if no buffer was attached.
+ */
+bool render_background_frame (struct Draw_surface *surface)
 {
 	struct Draw_output *output = surface->output;
 	struct App        *app  = output->app;
@@ -156,27 +815,160 @@ void render_background_frame (struct Draw_surface *surface)
 
 	printlog(app, 2, "[render] Render background frame: global_name=%d\n",
 			output->global_name);
+	TRACE_BEGIN(render_background_frame);
 
-	if (! next_buffer(&surface->current_background_buffer, app->shm,
-				surface->background_buffers,
-				surface->dimensions.w * scale,
-				surface->dimensions.h * scale))
-		return;
-	surface->current_background_buffer->busy = true;
-
-	cairo_t *cairo = surface->current_background_buffer->cairo;
+	/* A reused surface still has its last frame in the buffer, which
+	 * only needs to be attached to the new wl_surface.
+	 */
+	struct Draw_buffer *current = surface->current_background_buffer;
+	if ( ! surface->background_attached && surface->background_seq == surface->seq
+			&& current != NULL && current->buffer != NULL
+			&& current->w == surface->dimensions.w * scale
+			&& current->h == surface->dimensions.h * scale )
+	{
+		current->busy = true;
+		surface->background_attached = true;
+		wl_surface_set_buffer_scale(surface->background_surface, scale);
+		wl_surface_damage_buffer(surface->background_surface, 0, 0, INT32_MAX, INT32_MAX);
+		wl_surface_attach(surface->background_surface, current->buffer, 0, 0);
+		TRACE_END(render_background_frame);
+		return true;
+	}
 
-	PangoLayout * layout = pango_cairo_create_layout(cairo);
-	if (app->wordwrap) {
-		pango_layout_set_width (layout, app->dimensions.w * scale * PANGO_SCALE);
-		pango_layout_set_wrap (layout, PANGO_WRAP_WORD);
+	TRACE_BEGIN(next_buffer);
+	bool ok = next_buffer(&surface->current_background_buffer, app->shm,
+			surface->background_buffers,
+			surface->dimensions.w * scale, surface->dimensions.h * scale,
+			&app->stats.buffers_created);
+	TRACE_END(next_buffer);
+	if (! ok)
+	{
+		/* Retried once the compositor releases a buffer. */
+		surface->frame_pending = true;
+		app->stats.buffer_stalls++;
+		return false;
 	}
-	clear_buffer(cairo);
+	struct Draw_buffer *buffer = surface->current_background_buffer;
+	buffer->busy         = true;
+	buffer->release      = surface_buffer_released;
+	buffer->release_data = surface;
 
-	draw_background(cairo, &surface->dimensions, scale, app);
-	draw_main(cairo, layout, surface->font_description, &surface->dimensions,  scale, app);
+	clear_buffer(buffer->cairo);
+	draw_background(buffer->cairo, &surface->dimensions, scale, app);
 
+	surface->background_seq      = surface->seq;
+	surface->background_attached = true;
 	wl_surface_set_buffer_scale(surface->background_surface, scale);
 	wl_surface_damage_buffer(surface->background_surface, 0, 0, INT32_MAX, INT32_MAX);
-	wl_surface_attach(surface->background_surface, surface->current_background_buffer->buffer, 0, 0);
+	wl_surface_attach(surface->background_surface, buffer->buffer, 0, 0);
+	TRACE_END(render_background_frame);
+	return true;
+}
+
+/* Renders the next frame of the text surface. Buffers remember which
+ * content they hold, so only the panes which changed since the buffer was
+ * last used are redrawn, and only the panes which changed since the last
+ * commit are damaged. Returns false if no buffer was attached.
+ */
+bool render_text_frame (struct Draw_surface *surface)
+{
+	struct Draw_output *output = surface->output;
+	struct App        *app  = output->app;
+	uint32_t               scale  = output->scale;
+
+	printlog(app, 2, "[render] Render text frame: global_name=%d\n",
+			output->global_name);
+
+	int32_t area_x, area_y, area_w, area_h;
+	get_text_area(surface, &area_x, &area_y, &area_w, &area_h);
+	if ( area_w <= 0 || area_h <= 0 )
+		return false;
+
+	uint64_t start = monotonic_ns();
+	app->stats.frame_layout = 0;
+
+	/* Likewise for the text, if nothing changed since. */
+	struct Draw_buffer *prev = surface->current_text_buffer;
+	if ( ! surface->text_attached && prev != NULL && prev->buffer != NULL
+			&& prev->seq == app->seq
+			&& prev->w == (uint32_t)area_w * scale
+			&& prev->h == (uint32_t)area_h * scale )
+	{
+		prev->busy = true;
+		surface->committed_seq = app->seq;
+		surface->text_attached = true;
+		wl_surface_set_buffer_scale(surface->text_surface, scale);
+		wl_surface_damage_buffer(surface->text_surface, 0, 0, INT32_MAX, INT32_MAX);
+		wl_surface_attach(surface->text_surface, prev->buffer, 0, 0);
+		return true;
+	}
+
+	TRACE_BEGIN(next_buffer);
+	bool ok = next_buffer(&surface->current_text_buffer, app->shm,
+			surface->text_buffers,
+			(uint32_t)area_w * scale, (uint32_t)area_h * scale,
+			&app->stats.buffers_created);
+	TRACE_END(next_buffer);
+	if (! ok)
+	{
+		/* Retried once the compositor releases a buffer. */
+		surface->frame_pending = true;
+		app->stats.buffer_stalls++;
+		return false;
+	}
+	struct Draw_buffer *buffer = surface->current_text_buffer;
+	buffer->busy         = true;
+	buffer->release      = surface_buffer_released;
+	buffer->release_data = surface;
+
+	cairo_t *cairo = buffer->cairo;
+
+	bool full = buffer->seq < surface->seq;
+	if (full)
+		clear_buffer(cairo);
+
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+	{
+		struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+		if ( full || pane->seq > buffer->seq )
+		{
+			bool drawn;
+			if ( pane->tail > 0 )
+				drawn = ! full && scroll_tail(cairo, surface, pane, prev, buffer, scale);
+			else
+				drawn = draw_lines(cairo, surface, pane, prev, buffer, scale, full);
+			if (! drawn)
+				draw_pane(cairo, surface, pane, scale, full);
+			cache->tail_total = pane->tail_total;
+		}
+
+		if ( ! full && pane->seq > surface->committed_seq )
+		{
+			int32_t x, y, w, h;
+			get_buffer_rect(surface, pane, scale, &x, &y, &w, &h);
+			if ( cache->lines_drawn && cache->lines_damage_count > 0 )
+				for (size_t i = 0; i < cache->lines_damage_count; i++)
+					wl_surface_damage_buffer(surface->text_surface, x,
+							cache->lines_damage[i][0], w,
+							cache->lines_damage[i][1]);
+			else
+				wl_surface_damage_buffer(surface->text_surface, x, y, w, h);
+		}
+	}
+
+	buffer->seq = surface->committed_seq = app->seq;
+
+	/* Raster time is everything but the layouts. */
+	uint64_t end = monotonic_ns();
+	TRACE_RECORD("render_text_frame", start, end);
+	histogram_add(&app->stats.raster, end - start - app->stats.frame_layout);
+
+	/* A new wl_surface has no content yet, even if the buffer has. */
+	wl_surface_set_buffer_scale(surface->text_surface, scale);
+	if ( full || ! surface->text_attached )
+		wl_surface_damage_buffer(surface->text_surface, 0, 0, INT32_MAX, INT32_MAX);
+	surface->text_attached = true;
+	wl_surface_attach(surface->text_surface, buffer->buffer, 0, 0);
+	return true;
 }
@@ -2,9 +2,16 @@
 #define WLCLOCK_RENDER_H
 
 #include<stdbool.h>
+#include<pango/pangocairo.h>
 
+struct App;
 struct Draw_surface;
+struct Draw_pane_cache;
 
-void render_background_frame (struct Draw_surface *surface);
+bool render_background_frame (struct Draw_surface *surface);
+bool render_text_frame (struct Draw_surface *surface);
+PangoContext *get_pango_context (struct App *app);
+void drop_line_cache (struct Draw_pane_cache *cache);
+void drop_tail_cache (struct Draw_pane_cache *cache);
 
 #endif
@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<time.h>
+#include<sched.h>
+#include<unistd.h>
+#include<sys/resource.h>
+#include<sys/timerfd.h>
+#ifdef __linux__
+#include<sys/prctl.h>
+#endif
+
+#include"wayout.h"
+#include"misc.h"
+#include"scheduler.h"
+
+/* Weight of a new sample in the moving average, as a power of two. */
+#define COST_SHIFT 3
+
+/* Creates a timer for a periodic interval in nanoseconds. Aligned timers
+ * expire at multiples of the interval on the real time clock, so all
+ * aligned timers with a common interval, in all instances, expire together
+ * with each other and with the clocks. They are cancelled when the clock
+ * is set, so read_interval_timer() arms them again.
+ */
+int create_interval_timer (bool aligned, uint64_t interval)
+{
+	int fd = timerfd_create(aligned ? CLOCK_REALTIME : CLOCK_MONOTONIC,
+			TFD_NONBLOCK | TFD_CLOEXEC);
+	if ( fd == -1 )
+	{
+		printlog(NULL, 0, "ERROR: Unable to open timer fd.\n");
+		return -1;
+	}
+	if (! arm_interval_timer(fd, aligned, interval))
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool arm_interval_timer (int fd, bool aligned, uint64_t interval)
+{
+	struct itimerspec timer_value = { 0 };
+	timer_value.it_interval.tv_sec  = (time_t)(interval / 1000000000);
+	timer_value.it_interval.tv_nsec = (long)(interval % 1000000000);
+	timer_value.it_value = timer_value.it_interval;
+
+	int flags = 0;
+	if (aligned)
+	{
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		uint64_t next = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+		next = (next / interval + 1) * interval;
+		timer_value.it_value.tv_sec  = (time_t)(next / 1000000000);
+		timer_value.it_value.tv_nsec = (long)(next % 1000000000);
+		flags = TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET;
+	}
+
+	if ( timerfd_settime(fd, flags, &timer_value, NULL) == -1 )
+	{
+		printlog(NULL, 0, "ERROR: Unable to start timer.\n");
+		return false;
+	}
+	return true;
+}
+
+/* Returns false if the timer has not expired. */
+bool read_interval_timer (int fd, bool aligned, uint64_t interval, uint64_t *expirations)
+{
+	*expirations = 0;
+	if ( read(fd, expirations, sizeof(uint64_t)) == sizeof(uint64_t) )
+		return true;
+	if ( errno != ECANCELED )
+		return false;
+
+	/* The clock was set; The content is refreshed in any case. */
+	arm_interval_timer(fd, aligned, interval);
+	*expirations = 1;
+	return true;
+}
+
+/* Lets the kernel defer timers to coalesce wakeups with those of other
+ * processes and, for background widgets, only runs when the CPU would
+ * otherwise be idle.
+ */
+void enter_low_power (struct App *app)
+{
+#ifdef __linux__
+	if ( prctl(PR_SET_TIMERSLACK, LOW_POWER_TIMER_SLACK, 0, 0, 0) == -1 )
+		printlog(app, 1, "[scheduler] Can not set timer slack: %s\n", strerror(errno));
+#endif
+
+	if ( app->layer != ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND )
+		return;
+#ifdef SCHED_IDLE
+	struct sched_param param = { 0 };
+	if ( sched_setscheduler(0, SCHED_IDLE, &param) == 0 )
+	{
+		printlog(app, 1, "[scheduler] Using SCHED_IDLE.\n");
+		return;
+	}
+#endif
+	if ( setpriority(PRIO_PROCESS, 0, 19) == -1 )
+		printlog(app, 1, "[scheduler] Can not lower priority: %s\n", strerror(errno));
+}
+
+void init_scheduler (struct Scheduler *scheduler)
+{
+	memset(scheduler, 0, sizeof(struct Scheduler));
+	scheduler->fd = -1;
+}
+
+/* The interval is in milliseconds, like --interval. */
+bool start_scheduler (struct Scheduler *scheduler, int32_t interval, bool aligned)
+{
+	scheduler->aligned   = aligned;
+	scheduler->interval  = scheduler->effective = (uint64_t)interval * 1000000;
+	scheduler->fd        = create_interval_timer(aligned, scheduler->interval);
+	return scheduler->fd != -1;
+}
+
+void scheduler_add_cost (struct Scheduler *scheduler, uint64_t cost)
+{
+	scheduler->cost += cost;
+}
+
+/* Handles the expiry of the timer and adapts the interval to the cost of
+ * the frames rendered since the last one.
+ */
+void scheduler_tick (struct App *app)
+{
+	struct Scheduler *scheduler = &app->scheduler;
+	uint64_t expirations;
+	if (! read_interval_timer(scheduler->fd, scheduler->aligned,
+				scheduler->effective, &expirations))
+		return;
+
+	/* Ticks missed while the loop was busy are not caught up on. */
+	if ( expirations > 1 )
+		scheduler->ticks_dropped += expirations - 1;
+
+	scheduler->cost_average = scheduler->cost_average
+		- (scheduler->cost_average >> COST_SHIFT) + (scheduler->cost >> COST_SHIFT);
+	scheduler->cost = 0;
+
+	uint64_t interval = scheduler->interval;
+	if ( ! scheduler->overloaded && scheduler->cost_average > interval / 2 )
+	{
+		scheduler->overloaded = true;
+		scheduler->overloads++;
+		printlog(app, 1, "[scheduler] Overloaded: render_cost=%luus interval=%lums\n",
+				(unsigned long)(scheduler->cost_average / 1000),
+				(unsigned long)(interval / 1000000));
+	}
+	else if ( scheduler->overloaded && scheduler->cost_average < interval / 4 )
+	{
+		scheduler->overloaded = false;
+		printlog(app, 1, "[scheduler] Recovered: render_cost=%luus\n",
+				(unsigned long)(scheduler->cost_average / 1000));
+	}
+
+	uint64_t effective = interval;
+	if (scheduler->overloaded)
+	{
+		uint64_t stretch = (2 * scheduler->cost_average + interval - 1) / interval;
+		if ( stretch > SCHEDULER_MAX_STRETCH )
+			stretch = SCHEDULER_MAX_STRETCH;
+		if ( stretch > 1 )
+			effective = stretch * interval;
+	}
+	if ( effective != scheduler->effective )
+	{
+		printlog(app, 2, "[scheduler] Effective interval: %lums\n",
+				(unsigned long)(effective / 1000000));
+		if (arm_interval_timer(scheduler->fd, scheduler->aligned, effective))
+			scheduler->effective = effective;
+	}
+}
+
+void finish_scheduler (struct Scheduler *scheduler)
+{
+	if ( scheduler->fd != -1 )
+		close(scheduler->fd);
+	scheduler->fd = -1;
+}
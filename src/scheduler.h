@@ -0,0 +1,49 @@
+#ifndef WLCLOCK_SCHEDULER_H
+#define WLCLOCK_SCHEDULER_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+struct App;
+
+/* Limits how far the interval is stretched under overload. */
+#define SCHEDULER_MAX_STRETCH 64
+
+/* Timer slack in nanoseconds in low power mode. */
+#define LOW_POWER_TIMER_SLACK 50000000
+
+/* Paces the rendering of feeds with the interval timer. The render cost
+ * per tick is tracked as an exponential moving average. Once it exceeds
+ * half of the configured interval, the scheduler is overloaded and
+ * stretches the interval to the smallest multiple of the configured one
+ * which keeps rendering below half of it, dropping the frames in between.
+ * It returns to the configured interval once the cost falls below a
+ * quarter of it. All times are in nanoseconds.
+ */
+struct Scheduler
+{
+	int      fd;
+	bool     aligned;
+	uint64_t interval;
+	uint64_t effective;
+
+	/* Render cost since the last tick and its moving average. */
+	uint64_t cost;
+	uint64_t cost_average;
+
+	bool     overloaded;
+	uint64_t overloads;
+	uint64_t ticks_dropped;
+};
+
+int create_interval_timer (bool aligned, uint64_t interval);
+bool arm_interval_timer (int fd, bool aligned, uint64_t interval);
+bool read_interval_timer (int fd, bool aligned, uint64_t interval, uint64_t *expirations);
+void enter_low_power (struct App *app);
+void init_scheduler (struct Scheduler *scheduler);
+bool start_scheduler (struct Scheduler *scheduler, int32_t interval, bool aligned);
+void scheduler_add_cost (struct Scheduler *scheduler, uint64_t cost);
+void scheduler_tick (struct App *app);
+void finish_scheduler (struct Scheduler *scheduler);
+
+#endif
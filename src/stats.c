@@ -0,0 +1,335 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<unistd.h>
+#include<sys/timerfd.h>
+#ifdef __GLIBC__
+#include<malloc.h>
+#endif
+
+#include<pango/pangocairo.h>
+
+#include"wayout.h"
+#include"misc.h"
+#include"stats.h"
+#include"output.h"
+#include"surface.h"
+#include"buffer.h"
+#include"pane.h"
+
+/* Rough cost of a layout: the structures themselves, plus a copy of the
+ * text, the glyph info and the log cluster of every character.
+ */
+#define LAYOUT_OVERHEAD      1024
+#define LAYOUT_BYTES_PER_CHAR 32
+
+static const char *memory_names[MEMORY_CATEGORIES] = {
+	[MEMORY_BUFFERS] = "buffers",
+	[MEMORY_INPUTS]  = "inputs",
+	[MEMORY_TEXTS]   = "texts",
+	[MEMORY_LAYOUTS] = "layouts",
+	[MEMORY_HEAP]    = "heap",
+};
+
+void init_stats (struct Stats *stats)
+{
+	memset(stats, 0, sizeof(struct Stats));
+	stats->started  = monotonic_ns();
+	stats->interval = 10;
+	stats->fd       = -1;
+}
+
+/* Starts the timer writing the stats file, if there is one. */
+bool start_stats_timer (struct Stats *stats)
+{
+	if ( stats->path == NULL )
+		return true;
+
+	struct itimerspec spec = {
+		.it_value.tv_sec    = stats->interval,
+		.it_interval.tv_sec = stats->interval,
+	};
+	if ( -1 == (stats->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC))
+			|| -1 == timerfd_settime(stats->fd, 0, &spec, NULL) )
+	{
+		printlog(NULL, 0, "ERROR: Unable to start stats timer: %s\n",
+				strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+static size_t bucket_index (uint64_t value)
+{
+	if ( value < (1 << HISTOGRAM_SUB_BITS) )
+		return (size_t)value;
+	int msb = 63 - __builtin_clzll(value);
+	size_t sub = (size_t)(value >> (msb - HISTOGRAM_SUB_BITS))
+		& ((1 << HISTOGRAM_SUB_BITS) - 1);
+	return ((size_t)(msb - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + sub;
+}
+
+/* Returns the largest value which falls into the bucket. */
+static uint64_t bucket_limit (size_t index)
+{
+	if ( index < (1 << HISTOGRAM_SUB_BITS) )
+		return index;
+	int msb = (int)(index >> HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS - 1;
+	uint64_t sub = index & ((1 << HISTOGRAM_SUB_BITS) - 1);
+	uint64_t width = (uint64_t)1 << (msb - HISTOGRAM_SUB_BITS);
+	return (((uint64_t)1 << HISTOGRAM_SUB_BITS | sub) << (msb - HISTOGRAM_SUB_BITS))
+		+ width - 1;
+}
+
+void histogram_add (struct Histogram *histogram, uint64_t value)
+{
+	if ( histogram->count == 0 || value < histogram->min )
+		histogram->min = value;
+	if ( value > histogram->max )
+		histogram->max = value;
+	histogram->count++;
+	histogram->sum += value;
+	histogram->buckets[bucket_index(value)]++;
+}
+
+static uint64_t histogram_percentile (struct Histogram *histogram, double percentile)
+{
+	uint64_t rank = (uint64_t)((double)histogram->count * percentile / 100.0);
+	uint64_t seen = 0;
+	for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += histogram->buckets[i];
+		if ( seen > rank )
+		{
+			uint64_t limit = bucket_limit(i);
+			return limit > histogram->max ? histogram->max : limit;
+		}
+	}
+	return histogram->max;
+}
+
+static void dump_histogram (FILE *file, const char *name, struct Histogram *histogram)
+{
+	if ( histogram->count == 0 )
+	{
+		fprintf(file, "%s_us count=0\n", name);
+		return;
+	}
+	fprintf(file, "%s_us count=%lu min=%.1f mean=%.1f p50=%.1f p90=%.1f "
+			"p99=%.1f p99.9=%.1f max=%.1f\n",
+			name, (unsigned long)histogram->count,
+			(double)histogram->min / 1000.0,
+			(double)histogram->sum / (double)histogram->count / 1000.0,
+			(double)histogram_percentile(histogram, 50.0) / 1000.0,
+			(double)histogram_percentile(histogram, 90.0) / 1000.0,
+			(double)histogram_percentile(histogram, 99.0) / 1000.0,
+			(double)histogram_percentile(histogram, 99.9) / 1000.0,
+			(double)histogram->max / 1000.0);
+}
+
+static uint64_t layout_size (PangoLayout *layout)
+{
+	if ( layout == NULL )
+		return 0;
+	return LAYOUT_OVERHEAD + LAYOUT_BYTES_PER_CHAR
+		* (uint64_t)pango_layout_get_character_count(layout);
+}
+
+static uint64_t surface_buffer_size (struct Draw_surface *surface)
+{
+	return surface->background_buffers[0].size + surface->background_buffers[1].size
+		+ surface->text_buffers[0].size + surface->text_buffers[1].size;
+}
+
+static uint64_t surface_layout_size (struct App *app, struct Draw_surface *surface)
+{
+	if ( surface->pane_caches == NULL )
+		return 0;
+
+	uint64_t size = 0;
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+	{
+		struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+		size += sizeof(struct Draw_pane_cache) + layout_size(cache->layout);
+		size += cache->line_count * sizeof(struct Draw_line);
+		for (size_t i = 0; i < cache->line_count; i++)
+			size += layout_size(cache->lines[i].layout);
+		if ( cache->tail_layouts == NULL )
+			continue;
+		size += cache->tail_slots * (sizeof(PangoLayout *) + sizeof(uint64_t));
+		for (size_t i = 0; i < cache->tail_slots; i++)
+			size += layout_size(cache->tail_layouts[i]);
+	}
+	return size;
+}
+
+static void add_surface (uint64_t memory[static MEMORY_CATEGORIES],
+		struct App *app, struct Draw_surface *surface)
+{
+	memory[MEMORY_BUFFERS] += surface_buffer_size(surface);
+	memory[MEMORY_LAYOUTS] += surface_layout_size(app, surface);
+}
+
+/* Measures the memory of all categories and updates the peaks. This walks
+ * all panes and surfaces, so it is not done for every frame.
+ */
+void measure_memory (struct App *app)
+{
+	struct Stats *stats = &app->stats;
+	uint64_t memory[MEMORY_CATEGORIES] = { 0 };
+
+	struct Draw_output *output;
+	wl_list_for_each(output, &app->outputs, link)
+		if ( output->surface != NULL )
+			add_surface(memory, app, output->surface);
+	struct Draw_surface *surface;
+	wl_list_for_each(surface, &app->parked_surfaces, link)
+		add_surface(memory, app, surface);
+
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+	{
+		memory[MEMORY_INPUTS] += sizeof(struct Input) + pane->input.map_size;
+		if ( pane->input.data != NULL )
+			memory[MEMORY_INPUTS] += 2 * BUFFERSIZE;
+		if ( pane->text != NULL && ! pane->text_borrowed )
+			memory[MEMORY_TEXTS] += pane->text_len + 1;
+		if ( pane->raw != NULL )
+			memory[MEMORY_TEXTS] += pane->raw_len + 1;
+		memory[MEMORY_TEXTS] += document_memory(&pane->doc);
+		if ( pane->tail_lines == NULL )
+			continue;
+		memory[MEMORY_TEXTS] += pane->tail * (sizeof(char *) + sizeof(size_t));
+		for (size_t i = 0; i < pane->tail; i++)
+			if ( pane->tail_lines[i] != NULL )
+				memory[MEMORY_TEXTS] += pane->tail_lens[i] + 1;
+	}
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	struct mallinfo2 info = mallinfo2();
+	memory[MEMORY_HEAP] = info.uordblks + info.hblkhd;
+#endif
+
+	if ( memory[MEMORY_BUFFERS] != stats->memory[MEMORY_BUFFERS] )
+		printlog(app, 2, "[stats] Memory: buffers=%lu inputs=%lu texts=%lu "
+				"layouts=%lu heap=%lu\n",
+				(unsigned long)memory[MEMORY_BUFFERS],
+				(unsigned long)memory[MEMORY_INPUTS],
+				(unsigned long)memory[MEMORY_TEXTS],
+				(unsigned long)memory[MEMORY_LAYOUTS],
+				(unsigned long)memory[MEMORY_HEAP]);
+
+	for (size_t i = 0; i < MEMORY_CATEGORIES; i++)
+	{
+		stats->memory[i] = memory[i];
+		if ( memory[i] > stats->memory_peak[i] )
+			stats->memory_peak[i] = memory[i];
+	}
+}
+
+/* Writes the current and peak memory of all categories and the buffers of
+ * every output.
+ */
+void dump_memory (struct App *app, FILE *file)
+{
+	measure_memory(app);
+	for (size_t i = 0; i < MEMORY_CATEGORIES; i++)
+		fprintf(file, "memory_%s_bytes %lu peak=%lu\n", memory_names[i],
+				(unsigned long)app->stats.memory[i],
+				(unsigned long)app->stats.memory_peak[i]);
+
+	struct Draw_output *output;
+	wl_list_for_each(output, &app->outputs, link)
+		if ( output->surface != NULL )
+			fprintf(file, "output_buffers_bytes %lu name=%s scale=%u\n",
+					(unsigned long)surface_buffer_size(output->surface),
+					output->name != NULL ? output->name : "?",
+					output->scale);
+	struct Draw_surface *surface;
+	wl_list_for_each(surface, &app->parked_surfaces, link)
+		fprintf(file, "output_buffers_bytes %lu name=%s parked\n",
+				(unsigned long)surface_buffer_size(surface),
+				surface->output_name != NULL ? surface->output_name : "?");
+}
+
+/* Writes all counters and histograms as "name value" lines. */
+void dump_stats (struct App *app, FILE *file)
+{
+	struct Stats *stats = &app->stats;
+	double uptime = (double)(monotonic_ns() - stats->started) / 1000000000.0;
+
+	fprintf(file, "uptime_s %.1f\n", uptime);
+	fprintf(file, "wakeups %lu\n", (unsigned long)stats->wakeups);
+	fprintf(file, "wakeups_per_s %.2f\n",
+			uptime > 0 ? (double)stats->wakeups / uptime : 0.0);
+	fprintf(file, "records %lu\n", (unsigned long)stats->records);
+	fprintf(file, "records_dropped %lu\n", (unsigned long)stats->records_dropped);
+	fprintf(file, "records_coalesced %lu\n", (unsigned long)stats->records_coalesced);
+	fprintf(file, "frames %lu\n", (unsigned long)stats->frames);
+	fprintf(file, "frames_deferred %lu\n", (unsigned long)stats->frames_deferred);
+	fprintf(file, "buffer_stalls %lu\n", (unsigned long)stats->buffer_stalls);
+	fprintf(file, "buffers_created %lu\n", (unsigned long)stats->buffers_created);
+	dump_histogram(file, "record_to_commit", &stats->latency);
+	dump_histogram(file, "layout", &stats->layout);
+	dump_histogram(file, "raster", &stats->raster);
+	dump_histogram(file, "commit", &stats->commit);
+	if ( app->scheduler.fd != -1 )
+	{
+		struct Scheduler *scheduler = &app->scheduler;
+		fprintf(file, "interval_ms %lu\n", (unsigned long)(scheduler->interval / 1000000));
+		fprintf(file, "interval_effective_ms %lu\n",
+				(unsigned long)(scheduler->effective / 1000000));
+		fprintf(file, "render_cost_avg_us %lu\n",
+				(unsigned long)(scheduler->cost_average / 1000));
+		fprintf(file, "overloaded %d\n", scheduler->overloaded);
+		fprintf(file, "overloads %lu\n", (unsigned long)scheduler->overloads);
+		fprintf(file, "ticks_dropped %lu\n", (unsigned long)scheduler->ticks_dropped);
+	}
+	fprintf(file, "frames_presented %lu\n", (unsigned long)stats->frames_presented);
+	fprintf(file, "frames_discarded %lu\n", (unsigned long)stats->frames_discarded);
+	dump_histogram(file, "record_to_present", &stats->photon);
+	dump_histogram(file, "record_to_present_queueing", &stats->queueing);
+	dump_histogram(file, "record_to_present_render", &stats->render);
+	dump_histogram(file, "record_to_present_compositor", &stats->compositor);
+	dump_memory(app, file);
+}
+
+/* Replaces the stats file, so readers never see a partial file. */
+void write_stats_file (struct App *app)
+{
+	struct Stats *stats = &app->stats;
+	size_t len = strlen(stats->path) + 5;
+	char *tmp = malloc(len);
+	if ( tmp == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return;
+	}
+	snprintf(tmp, len, "%s.tmp", stats->path);
+
+	FILE *file = fopen(tmp, "w");
+	if ( file == NULL )
+	{
+		printlog(app, 1, "[stats] Can not write \"%s\": %s\n", tmp, strerror(errno));
+		free(tmp);
+		return;
+	}
+	dump_stats(app, file);
+	if ( fclose(file) != 0 || rename(tmp, stats->path) == -1 )
+		printlog(app, 1, "[stats] Can not write \"%s\": %s\n",
+				stats->path, strerror(errno));
+	free(tmp);
+}
+
+void finish_stats (struct Stats *stats)
+{
+	if ( stats->fd != -1 )
+		close(stats->fd);
+	stats->fd = -1;
+	free_if_set(stats->path);
+	stats->path = NULL;
+}
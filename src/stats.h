@@ -0,0 +1,92 @@
+#ifndef WLCLOCK_STATS_H
+#define WLCLOCK_STATS_H
+
+#include<stdbool.h>
+#include<stdint.h>
+#include<stdio.h>
+
+/* Values are sorted into buckets by their highest set bit, each split into
+ * 1 << HISTOGRAM_SUB_BITS linear sub-buckets, which bounds the error of
+ * any reported percentile to 25% at a fixed size of 2 KiB per histogram.
+ */
+#define HISTOGRAM_SUB_BITS 2
+#define HISTOGRAM_BUCKETS  (64 << HISTOGRAM_SUB_BITS)
+
+struct App;
+
+/* Memory is accounted by category. Only the shm buffers, inputs and texts
+ * are exact. Pango does not expose the size of a layout, so layouts are
+ * estimated from their length, and the heap, where supported, also covers
+ * everything else, most notably the fonts loaded by Pango and fontconfig.
+ */
+enum Memory_category
+{
+	MEMORY_BUFFERS,
+	MEMORY_INPUTS,
+	MEMORY_TEXTS,
+	MEMORY_LAYOUTS,
+	MEMORY_HEAP,
+	MEMORY_CATEGORIES,
+};
+
+struct Histogram
+{
+	uint64_t count, sum, min, max;
+	uint64_t buckets[HISTOGRAM_BUCKETS];
+};
+
+/* Counters are always kept, as incrementing them costs next to nothing.
+ * All times are in nanoseconds of CLOCK_MONOTONIC.
+ */
+struct Stats
+{
+	uint64_t started;
+
+	uint64_t wakeups;
+	uint64_t records;
+	uint64_t records_dropped;
+	uint64_t records_coalesced;
+	uint64_t frames;
+	uint64_t frames_deferred;
+	uint64_t buffer_stalls;
+	uint64_t buffers_created;
+
+	struct Histogram latency;
+	struct Histogram layout;
+	struct Histogram raster;
+	struct Histogram commit;
+
+	/* From wp_presentation feedback: the time from a record arriving to
+	 * the frame showing it being presented, split into waiting for the
+	 * frame to start, rendering and the compositor.
+	 */
+	uint64_t         frames_presented;
+	uint64_t         frames_discarded;
+	struct Histogram photon;
+	struct Histogram queueing;
+	struct Histogram render;
+	struct Histogram compositor;
+
+	/* Bytes by category, as of the last measurement, and the peaks. */
+	uint64_t memory[MEMORY_CATEGORIES];
+	uint64_t memory_peak[MEMORY_CATEGORIES];
+
+	/* Time spent on layouts during the frame being rendered. */
+	uint64_t frame_layout;
+
+	/* Written periodically, if set. */
+	char    *path;
+	int32_t  interval;
+	int      fd;
+};
+
+void init_stats (struct Stats *stats);
+bool start_stats_timer (struct Stats *stats);
+void histogram_add (struct Histogram *histogram, uint64_t value);
+void measure_memory (struct App *app);
+void dump_memory (struct App *app, FILE *file);
+void dump_stats (struct App *app, FILE *file);
+void write_stats_file (struct App *app);
+void finish_stats (struct Stats *stats);
+
+#endif
@@ -20,6 +20,240 @@
 #include"surface.h"
 #include"buffer.h"
 #include"render.h"
+#include"pane.h"
+#include"colour.h"
+#include"trace.h"
+#include"presentation.h"
+
+static void present_frame (struct Draw_surface *surface);
+
+static int32_t clamp_radius (int32_t radius, int32_t max)
+{
+	return radius > max ? max : radius;
+}
+
+/* Tells the compositor which part of the parent surface is opaque, so it
+ * can skip blending it and drawing whatever is behind it. That is the
+ * rectangle covered by opaque colours, without its rounded corners. The
+ * region is only sent if it changed.
+ */
+static void update_opaque_region (struct Draw_surface *surface)
+{
+	struct App *app = surface->app;
+	int32_t x = 0, y = 0, w = surface->dimensions.w, h = surface->dimensions.h;
+	bool border = app->border_left || app->border_right
+		|| app->border_top || app->border_bottom;
+
+	if ( app->background_colour.a < 1.0 )
+		w = h = 0;
+	else if ( border && app->border_colour.a < 1.0 )
+	{
+		x = app->border_left;
+		y = app->border_top;
+		w -= app->border_left + app->border_right;
+		h -= app->border_top + app->border_bottom;
+	}
+	if ( w <= 0 || h <= 0 )
+		w = h = 0;
+
+	/* Same limit as when drawing. */
+	int32_t max = (surface->dimensions.w > surface->dimensions.h
+			? surface->dimensions.w : surface->dimensions.h) / 2;
+	int32_t radii[4] = {
+		clamp_radius(app->radius_top_left, max),
+		clamp_radius(app->radius_top_right, max),
+		clamp_radius(app->radius_bottom_left, max),
+		clamp_radius(app->radius_bottom_right, max),
+	};
+
+	if ( x == surface->opaque_x && y == surface->opaque_y
+			&& w == surface->opaque_w && h == surface->opaque_h
+			&& ! memcmp(radii, surface->opaque_radii, sizeof(radii)) )
+		return;
+	surface->opaque_x = x;
+	surface->opaque_y = y;
+	surface->opaque_w = w;
+	surface->opaque_h = h;
+	memcpy(surface->opaque_radii, radii, sizeof(radii));
+
+	printlog(app, 2, "[surface] Opaque region: x=%d y=%d w=%d h=%d\n", x, y, w, h);
+
+	if ( w == 0 )
+	{
+		wl_surface_set_opaque_region(surface->background_surface, NULL);
+		return;
+	}
+	struct wl_region *region = wl_compositor_create_region(app->compositor);
+	wl_region_add(region, x, y, w, h);
+	wl_region_subtract(region, x, y, radii[0], radii[0]);
+	wl_region_subtract(region, x + w - radii[1], y, radii[1], radii[1]);
+	wl_region_subtract(region, x, y + h - radii[2], radii[2], radii[2]);
+	wl_region_subtract(region, x + w - radii[3], y + h - radii[3], radii[3], radii[3]);
+	wl_surface_set_opaque_region(surface->background_surface, region);
+	wl_region_destroy(region);
+}
+
+static bool is_suspended (struct Draw_surface *surface)
+{
+	return surface->output->app->idle || ! surface->output->powered;
+}
+
+static void frame_handle_done (void *data, struct wl_callback *callback,
+		uint32_t time)
+{
+	struct Draw_surface *surface = (struct Draw_surface *)data;
+	wl_callback_destroy(callback);
+	surface->frame_callback = NULL;
+
+	if ( surface->frame_pending && ! is_suspended(surface) )
+	{
+		printlog(surface->output->app, 2,
+				"[surface] Presenting pending frame: global_name=%d\n",
+				surface->output->global_name);
+		present_frame(surface);
+	}
+}
+
+static const struct wl_callback_listener frame_listener = {
+	.done = frame_handle_done,
+};
+
+/* Called when the compositor released one of the buffers of the surface.
+ * A frame which found no free buffer has no frame callback to wait for,
+ * so it is presented now.
+ */
+void surface_buffer_released (void *data)
+{
+	struct Draw_surface *surface = (struct Draw_surface *)data;
+	if ( surface->output == NULL || ! surface->configured )
+		return;
+	if ( surface->frame_pending && surface->frame_callback == NULL
+			&& ! is_suspended(surface) )
+	{
+		printlog(surface->output->app, 2,
+				"[surface] Presenting frame after buffer release: global_name=%d\n",
+				surface->output->global_name);
+		present_frame(surface);
+	}
+}
+
+static void report_timing (struct App *app, const char *what, uint64_t at)
+{
+	uint64_t origin = app->timing.exec != 0 ? app->timing.exec : app->timing.main;
+	if ( at != 0 )
+		printlog(NULL, 0, "[timing] %-16s %8.3f ms\n", what,
+				(double)(at - origin) / 1000000.0);
+}
+
+/* Reports the time from the start of the process (or from main() if that
+ * is unknown) to each step until the first committed frame. Steps overlap,
+ * so they are reported as points in time rather than durations.
+ */
+static void report_startup_timing (struct App *app)
+{
+	printlog(NULL, 0, "[timing] Startup, since %s:\n",
+			app->timing.exec != 0 ? "exec" : "main()");
+	report_timing(app, "main()", app->timing.main);
+	report_timing(app, "connected", app->timing.connected);
+	report_timing(app, "globals bound", app->timing.globals);
+	report_timing(app, "panes loaded", app->timing.panes);
+	report_timing(app, "first configure", app->timing.configured);
+	report_timing(app, "first commit", app->timing.committed);
+}
+
+/* Renders and commits the next frame, asking the compositor to signal when
+ * it is a good time to draw the one after it. The content is taken from
+ * the panes at this point, so any number of updates requested in between
+ * result in a single frame with the latest content.
+ */
+static void commit_background (struct Draw_surface *surface)
+{
+	TRACE_BEGIN(commit_background);
+	wl_surface_commit(surface->background_surface);
+	TRACE_END(commit_background);
+}
+
+static void present_frame (struct Draw_surface *surface)
+{
+	uint64_t render_start = monotonic_ns();
+	surface->frame_pending = false;
+	if ( surface->frame_callback != NULL )
+		wl_callback_destroy(surface->frame_callback);
+	surface->frame_callback = NULL;
+
+	/* The text surface is committed on its own once the subsurface is
+	 * desynchronised. The parent is only committed if the background
+	 * changed, which also applies the subsurface position.
+	 */
+	bool background = surface->background_seq < surface->seq
+		|| ! surface->background_attached;
+	if (background)
+	{
+		int32_t x, y, w, h;
+		get_text_area(surface, &x, &y, &w, &h);
+		wl_subsurface_set_position(surface->subsurface, x, y);
+		update_opaque_region(surface);
+		render_background_frame(surface);
+	}
+
+	/* A commit without new content is not guaranteed to ever get a
+	 * frame callback, so without a buffer there is nothing to commit.
+	 * If all buffers were busy, the frame is pending and presented from
+	 * surface_buffer_released().
+	 */
+	bool first = ! surface->text_attached;
+	if (! render_text_frame(surface))
+	{
+		if (background)
+			commit_background(surface);
+		return;
+	}
+
+	surface->scale = surface->output->scale;
+	surface->frame_callback = wl_surface_frame(surface->text_surface);
+	wl_callback_add_listener(surface->frame_callback, &frame_listener, surface);
+
+	/* The oldest record this frame shows, if any. */
+	struct App *app = surface->output->app;
+	struct Draw_pane *pane;
+	uint64_t record_time = 0;
+	wl_list_for_each(pane, &app->panes, link)
+		if ( pane->record_time != 0 && pane->seq <= surface->committed_seq
+				&& ( record_time == 0 || pane->record_time < record_time ) )
+			record_time = pane->record_time;
+	if ( record_time != 0 )
+		request_presentation_feedback(surface, record_time, render_start);
+
+	/* New wl_surfaces start out synchronised, so the first frame of
+	 * both is shown at once by the commit of the parent.
+	 */
+	uint64_t start = monotonic_ns();
+	wl_surface_commit(surface->text_surface);
+	if (background)
+		commit_background(surface);
+	if (first)
+		wl_subsurface_set_desync(surface->subsurface);
+	wl_display_flush(app->display);
+	uint64_t now = monotonic_ns();
+	TRACE_RECORD("commit", start, now);
+	histogram_add(&app->stats.commit, now - start);
+	scheduler_add_cost(&app->scheduler, now - render_start);
+	app->stats.frames++;
+
+	wl_list_for_each(pane, &app->panes, link)
+		if ( pane->record_time != 0 && pane->seq <= surface->committed_seq )
+		{
+			histogram_add(&app->stats.latency, now - pane->record_time);
+			pane->record_time = 0;
+		}
+
+	if ( app->timing.committed == 0 )
+	{
+		app->timing.committed = monotonic_ns();
+		if (app->timing.enabled)
+			report_startup_timing(app);
+	}
+}
 
 static void layer_surface_handle_configure (void *data,
 		struct zwlr_layer_surface_v1 *layer_surface, uint32_t serial,
@@ -43,7 +277,7 @@ static void layer_surface_handle_configure (void *data,
 	}
 	if ( h != (uint32_t)surface->dimensions.h )
 	{
-		surface->dimensions.w = w == 0 ? app->dimensions.h : (int32_t)h;
+		surface->dimensions.h = h == 0 ? app->dimensions.h : (int32_t)h;
 		dimensions_changed = true;
 	}
 
@@ -54,11 +288,16 @@ static void layer_surface_handle_configure (void *data,
 	 */
 	if ( dimensions_changed || !surface->configured )
 	{
+		if ( app->timing.configured == 0 )
+			app->timing.configured = monotonic_ns();
 		surface->configured = true;
+		surface->seq = ++app->seq;
 		app->ready = true;
 
-		render_background_frame(surface);
-		wl_surface_commit(surface->background_surface);
+		/* A new size needs a new buffer, even if a frame is still
+		 * in flight.
+		 */
+		present_frame(surface);
 	}
 }
 
@@ -73,7 +312,7 @@ static void layer_surface_handle_closed (void *data, struct zwlr_layer_surface_v
 	printlog(surface->output->app, 1,
 			"[surface] Layer surface has been closed: global_name=%d\n",
 			surface->output->global_name);
-	destroy_surface(surface);
+	park_surface(surface);
 }
 
 const struct zwlr_layer_surface_v1_listener layer_surface_listener = {
@@ -88,11 +327,11 @@ static int32_t get_exclusive_zone (struct Draw_surface *surface)
 	{
 		case ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM:
 		case ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP:
-			return surface->dimensions.h;
+			return app->dimensions.h;
 
 		case ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT:
 		case ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT:
-			return surface->dimensions.w;
+			return app->dimensions.w;
 
 		default:
 			return 0;
@@ -101,26 +340,40 @@ static int32_t get_exclusive_zone (struct Draw_surface *surface)
 		return surface->output->app->exclusive_zone;
 }
 
-
-bool create_surface (struct Draw_output *output)
+static void configure_layer_surface (struct Draw_surface *surface)
 {
-	struct App *app = output->app;
-	printlog(app, 1, "[surface] Creating surface: global_name=%d\n", output->global_name);
+	struct App *app = surface->output->app;
+	zwlr_layer_surface_v1_set_size(surface->layer_surface,
+			app->dimensions.w, app->dimensions.h);
+	zwlr_layer_surface_v1_set_anchor(surface->layer_surface, app->anchor);
+	zwlr_layer_surface_v1_set_margin(surface->layer_surface,
+			app->margin_top, app->margin_right,
+			app->margin_bottom, app->margin_left);
+	zwlr_layer_surface_v1_set_exclusive_zone(surface->layer_surface,
+			get_exclusive_zone(surface));
+}
 
-	struct Draw_surface *surface = calloc(1, sizeof(struct Draw_surface));
-	if ( surface == NULL )
+static void drop_pane_caches (struct Draw_surface *surface)
+{
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &surface->app->panes, link)
 	{
-		printlog(NULL, 0, "ERROR: Could not allocate.\n");
-		return false;
+		struct Draw_pane_cache *cache = &surface->pane_caches[pane->index];
+		if ( cache->layout != NULL )
+		{
+			g_object_unref(cache->layout);
+			cache->layout = NULL;
+		}
+		drop_line_cache(cache);
+		drop_tail_cache(cache);
 	}
+}
 
-	output->surface             = surface;
-	surface->dimensions         = app->dimensions;
-	surface->output             = output;
-	surface->background_surface = NULL;
-	surface->layer_surface      = NULL;
-	surface->configured         = false;
-	surface->font_description   = pango_font_description_from_string(app->font_pattern);
+/* Creates the Wayland side of the surface on its output. */
+static void create_layer_surface (struct Draw_surface *surface)
+{
+	struct App *app = surface->app;
+	struct Draw_output *output = surface->output;
 
 	surface->background_surface = wl_compositor_create_surface(app->compositor);
 	surface->layer_surface = zwlr_layer_shell_v1_get_layer_surface(
@@ -131,23 +384,121 @@ bool create_surface (struct Draw_output *output)
     /* Set up layer surface */
 	zwlr_layer_surface_v1_add_listener(surface->layer_surface,
 			&layer_surface_listener, surface);
+	configure_layer_surface(surface);
+
+	/* Set up text subsurface */
+	surface->text_surface = wl_compositor_create_surface(app->compositor);
+	surface->subsurface = wl_subcompositor_get_subsurface(app->subcompositor,
+			surface->text_surface, surface->background_surface);
 
-	zwlr_layer_surface_v1_set_size(surface->layer_surface,
-			surface->dimensions.w, surface->dimensions.h);
-	zwlr_layer_surface_v1_set_anchor(surface->layer_surface, app->anchor);
-	zwlr_layer_surface_v1_set_margin(surface->layer_surface,
-			app->margin_top, app->margin_right,
-			app->margin_bottom, app->margin_left);
-	zwlr_layer_surface_v1_set_exclusive_zone(surface->layer_surface,
-			get_exclusive_zone(surface));
 	if (! app->input)
 	{
 		struct wl_region *region = wl_compositor_create_region(app->compositor);
 		wl_surface_set_input_region(surface->background_surface, region);
+		wl_surface_set_input_region(surface->text_surface, region);
 		wl_region_destroy(region);
 	}
 
 	wl_surface_commit(surface->background_surface);
+}
+
+static void destroy_layer_surface (struct Draw_surface *surface)
+{
+	if ( surface->frame_callback != NULL )
+		wl_callback_destroy(surface->frame_callback);
+	if ( surface->subsurface != NULL )
+		wl_subsurface_destroy(surface->subsurface);
+	if ( surface->text_surface != NULL )
+		wl_surface_destroy(surface->text_surface);
+	if ( surface->layer_surface != NULL )
+		zwlr_layer_surface_v1_destroy(surface->layer_surface);
+	if ( surface->background_surface != NULL )
+		wl_surface_destroy(surface->background_surface);
+	surface->frame_callback      = NULL;
+	surface->frame_pending       = false;
+	surface->subsurface          = NULL;
+	surface->text_surface        = NULL;
+	surface->layer_surface       = NULL;
+	surface->background_surface  = NULL;
+	surface->configured          = false;
+	surface->background_attached = false;
+	surface->text_attached       = false;
+	surface->opaque_w            = -1;
+}
+
+/* Takes the parked surface of an output with the given name, if any. */
+static struct Draw_surface *unpark_surface (struct App *app, const char *name)
+{
+	struct Draw_surface *surface;
+	wl_list_for_each(surface, &app->parked_surfaces, link)
+		if (! strcmp(surface->output_name, name))
+		{
+			wl_list_remove(&surface->link);
+			free_if_set(surface->output_name);
+			surface->output_name = NULL;
+			return surface;
+		}
+	return NULL;
+}
+
+bool create_surface (struct Draw_output *output)
+{
+	struct App *app = output->app;
+
+	struct Draw_surface *surface = unpark_surface(app, output->name);
+	if ( surface != NULL )
+	{
+		/* Unless the scale changed, the buffers still hold the last
+		 * frame. The background buffer is attached again as it is
+		 * and only the panes which changed in the meantime are drawn
+		 * into a text buffer.
+		 */
+		printlog(app, 1, "[surface] Reusing parked surface: global_name=%d\n",
+				output->global_name);
+		output->surface  = surface;
+		surface->output  = output;
+		if ( surface->scale != output->scale )
+			surface->seq = ++app->seq;
+		create_layer_surface(surface);
+		return true;
+	}
+
+	printlog(app, 1, "[surface] Creating surface: global_name=%d\n", output->global_name);
+
+	surface = calloc(1, sizeof(struct Draw_surface));
+	if ( surface == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return false;
+	}
+
+	output->surface             = surface;
+	surface->app                = app;
+	surface->dimensions         = app->dimensions;
+	surface->output             = output;
+	surface->background_surface = NULL;
+	surface->layer_surface      = NULL;
+	surface->text_surface       = NULL;
+	surface->subsurface         = NULL;
+	surface->configured         = false;
+	surface->background_attached = false;
+	surface->text_attached      = false;
+	surface->opaque_w           = -1;
+	surface->frame_callback     = NULL;
+	surface->frame_pending      = false;
+	surface->output_name        = NULL;
+	surface->scale              = output->scale;
+	surface->pane_caches        = calloc((size_t)wl_list_length(&app->panes),
+			sizeof(struct Draw_pane_cache));
+	if ( surface->pane_caches == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		output->surface = NULL;
+		free(surface);
+		return false;
+	}
+
+	create_layer_surface(surface);
 	return true;
 }
 
@@ -157,24 +508,220 @@ void destroy_surface (struct Draw_surface *surface)
 		return;
 	if ( surface->output != NULL )
 		surface->output->surface = NULL;
-	if ( surface->layer_surface != NULL )
-		zwlr_layer_surface_v1_destroy(surface->layer_surface);
-	if ( surface->background_surface != NULL )
-		wl_surface_destroy(surface->background_surface);
-	finish_buffer(&surface->background_buffers[0]);
-	finish_buffer(&surface->background_buffers[1]);
+	destroy_layer_surface(surface);
+	for (size_t i = 0; i < 2; i++)
+	{
+		finish_buffer(&surface->background_buffers[i]);
+		finish_buffer(&surface->text_buffers[i]);
+	}
+	drop_pane_caches(surface);
+	free(surface->pane_caches);
+	free_if_set(surface->output_name);
 	free(surface);
 }
 
+/* Detaches the surface from its output, which is going away. Outputs
+ * commonly come back shortly after, for example when docking or when a
+ * monitor is re-plugged, so everything but the Wayland surface itself is
+ * kept around for a while.
+ */
+void park_surface (struct Draw_surface *surface)
+{
+	struct App *app = surface->app;
+	struct Draw_output *output = surface->output;
+	if ( output == NULL || output->name == NULL )
+	{
+		destroy_surface(surface);
+		return;
+	}
+
+	printlog(app, 1, "[surface] Parking surface: name=%s\n", output->name);
+	destroy_layer_surface(surface);
+	surface->output_name = strdup(output->name);
+	surface->parked_at   = monotonic_ns();
+	surface->output      = NULL;
+	output->surface      = NULL;
+	if ( surface->output_name == NULL )
+	{
+		destroy_surface(surface);
+		return;
+	}
+
+	wl_list_insert(&app->parked_surfaces, &surface->link);
+	prune_parked_surfaces(app, false);
+}
+
+/* Destroys parked surfaces once their grace period is over, or the oldest
+ * ones if there are too many. If all is true, destroys all of them.
+ */
+void prune_parked_surfaces (struct App *app, bool all)
+{
+	uint64_t now = monotonic_ns();
+	int count = 0;
+	struct Draw_surface *surface, *tmp;
+
+	/* Newest first. */
+	wl_list_for_each_safe(surface, tmp, &app->parked_surfaces, link)
+		if ( all || ++count > PARKED_SURFACES_MAX
+				|| now - surface->parked_at
+					> (uint64_t)PARKED_SURFACE_GRACE * 1000000000 )
+		{
+			printlog(app, 1, "[surface] Dropping parked surface: name=%s\n",
+					surface->output_name);
+			wl_list_remove(&surface->link);
+			destroy_surface(surface);
+		}
+}
+
+/* Returns the milliseconds until the next parked surface is to be
+ * destroyed, or -1 if there is none, as a timeout for poll().
+ */
+int parked_surfaces_timeout (struct App *app)
+{
+	uint64_t grace = (uint64_t)PARKED_SURFACE_GRACE * 1000000000;
+	uint64_t now = monotonic_ns();
+	int timeout = -1;
+	struct Draw_surface *surface;
+	wl_list_for_each(surface, &app->parked_surfaces, link)
+	{
+		uint64_t elapsed = now - surface->parked_at;
+		int ms = elapsed >= grace ? 0 : (int)((grace - elapsed + 999999) / 1000000);
+		if ( timeout == -1 || ms < timeout )
+			timeout = ms;
+	}
+	return timeout;
+}
+
+/* Gets the area inside the border, which the text surface covers, in
+ * surface coordinates.
+ */
+void get_text_area (struct Draw_surface *surface, int32_t *x, int32_t *y,
+		int32_t *w, int32_t *h)
+{
+	struct App *app = surface->app;
+	*x = app->border_left;
+	*y = app->border_top;
+	*w = surface->dimensions.w - app->border_left - app->border_right;
+	*h = surface->dimensions.h - app->border_top - app->border_bottom;
+}
+
+/* Presents a frame as soon as possible, which is right away unless a frame
+ * is already in flight or the surface is suspended.
+ */
+void schedule_frame (struct Draw_surface *surface)
+{
+	if (! surface->configured)
+		return;
+
+	/* Hidden surfaces and outputs which are off never signal a
+	 * frame, so they stop rendering at all.
+	 */
+	if ( surface->frame_callback != NULL || is_suspended(surface) )
+	{
+		surface->frame_pending = true;
+		surface->app->stats.frames_deferred++;
+	}
+	else
+		present_frame(surface);
+}
+
 void update (struct App *app)
 {
 	printlog(app, 1, "[surface] Updating\n");
 	struct Draw_output *op, *tmp;
 	wl_list_for_each_safe(op, tmp, &app->outputs, link)
+		if ( op->surface != NULL )
+			schedule_frame(op->surface);
+	prune_parked_surfaces(app, false);
+
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+		pane->dirty = false;
+}
+
+
+/* Stops rendering the surface, for example because its output has been
+ * powered off. Buffers the compositor does not hold are released.
+ */
+void suspend_surface (struct Draw_surface *surface)
+{
+	printlog(surface->output->app, 1, "[surface] Suspending: global_name=%d\n",
+			surface->output->global_name);
+	for (size_t i = 0; i < 2; i++)
+	{
+		if (! surface->background_buffers[i].busy)
+			finish_buffer(&surface->background_buffers[i]);
+		if (! surface->text_buffers[i].busy)
+			finish_buffer(&surface->text_buffers[i]);
+	}
+}
+
+/* Renders exactly one frame with the current content, unless the surface
+ * is still suspended for another reason. A frame callback requested before
+ * the surface was suspended may never arrive, so it is not waited for.
+ */
+void resume_surface (struct Draw_surface *surface)
+{
+	if ( ! surface->configured || is_suspended(surface) )
+		return;
+	printlog(surface->output->app, 1, "[surface] Resuming: global_name=%d\n",
+			surface->output->global_name);
+	present_frame(surface);
+}
+
+/* Returns true if there is at least one surface and none of them is
+ * rendering, in which case timers have no reason to run.
+ */
+bool surfaces_suspended (struct App *app)
+{
+	bool any = false;
+	struct Draw_output *op;
+	wl_list_for_each(op, &app->outputs, link)
 		if ( op->surface != NULL )
 		{
-			render_background_frame(op->surface);
+			if (! is_suspended(op->surface))
+				return false;
+			any = true;
+		}
+	return any;
+}
+
+/* Sends the current size, position and exclusive zone to all layer
+ * surfaces. The compositor answers with a configure event, which causes a
+ * new frame if the size changed.
+ */
+void reconfigure_surfaces (struct App *app)
+{
+	struct Draw_output *op;
+	wl_list_for_each(op, &app->outputs, link)
+		if ( op->surface != NULL )
+		{
+			configure_layer_surface(op->surface);
 			wl_surface_commit(op->surface->background_surface);
 		}
 }
 
+/* Forces the next frame of all surfaces to be redrawn entirely, for example
+ * because the colour of the border changed.
+ */
+void invalidate_surfaces (struct App *app)
+{
+	struct Draw_output *op;
+	wl_list_for_each(op, &app->outputs, link)
+		if ( op->surface != NULL )
+			op->surface->seq = ++app->seq;
+}
+
+/* Drops all layouts, which must happen before the Pango context they were
+ * created with is destroyed.
+ */
+void drop_surface_caches (struct App *app)
+{
+	struct Draw_output *op;
+	wl_list_for_each(op, &app->outputs, link)
+		if ( op->surface != NULL )
+			drop_pane_caches(op->surface);
+	struct Draw_surface *surface;
+	wl_list_for_each(surface, &app->parked_surfaces, link)
+		drop_pane_caches(surface);
+}
@@ -13,23 +13,131 @@
 struct App;
 struct Draw_output;
 
+/* A line of a multi-line text, at y with height h in buffer coordinates. */
+struct Draw_line
+{
+	uint64_t     hash;
+	PangoLayout *layout;
+	int32_t      y, h;
+};
+
+#define LINE_DAMAGE_MAX 8
+
+/* Per-pane state which depends on the scale of the output. */
+struct Draw_pane_cache
+{
+	PangoLayout *layout;
+	uint64_t     layout_seq;
+	int32_t      width;
+
+	/* Layouts of the lines of a tail or document pane, in tail_slots
+	 * slots indexed by the line number modulo their count, with the line
+	 * number plus one each was shaped for. tail_total is the number of
+	 * lines of a tail the last committed frame shows.
+	 */
+	PangoLayout **tail_layouts;
+	uint64_t     *tail_shaped;
+	size_t        tail_slots;
+	uint64_t      tail_total;
+	int32_t       line_height;
+
+	/* Multi-line texts are laid out line by line, so lines which did not
+	 * change keep their layout and, if lines_drawn, their pixels, moved
+	 * if their position changed. lines_x is where the lines start and
+	 * lines_y, lines_h the band they covered. The bands damaged by the
+	 * last draw are listed, a count of 0 means the entire pane.
+	 */
+	struct Draw_line *lines;
+	size_t            line_count;
+	uint64_t          lines_style_seq;
+	int32_t           lines_width;
+	int32_t           lines_x, lines_y, lines_h;
+	bool              lines_drawn;
+	int32_t           lines_damage[LINE_DAMAGE_MAX][2];
+	size_t            lines_damage_count;
+};
+
 struct Draw_surface
 {
+	struct App                *app;
 	struct Draw_output        *output;
 	struct wl_surface            *background_surface;
-	struct wl_surface            *hands_surface;
+	struct wl_surface            *text_surface;
 	struct wl_subsurface         *subsurface;
 	struct zwlr_layer_surface_v1 *layer_surface;
 
 	struct Draw_dimensions dimensions;
+	/* The border and background are drawn on the parent surface, which
+	 * only changes on configure or when the style changes. The panes are
+	 * drawn on a desynchronised subsurface covering the area inside the
+	 * border, so updating them never touches the background.
+	 */
 	struct Draw_buffer  background_buffers[2];
 	struct Draw_buffer *current_background_buffer;
-	PangoFontDescription *font_description;
+	struct Draw_buffer  text_buffers[2];
+	struct Draw_buffer *current_text_buffer;
 	bool configured;
+
+	/* Buffers holding content older than seq are redrawn entirely, for
+	 * example after the surface has been resized. committed_seq is the
+	 * content of the last frame of the text surface, background_seq the
+	 * value of seq the background was last drawn for.
+	 */
+	uint64_t seq;
+	uint64_t committed_seq;
+	uint64_t background_seq;
+
+	/* At most one frame is in flight at a time. Updates requested until
+	 * the compositor signals that it is a good time to draw again are
+	 * collapsed into a single pending frame.
+	 */
+	struct wl_callback *frame_callback;
+	bool                frame_pending;
+
+	/* Indexed by pane->index. */
+	struct Draw_pane_cache *pane_caches;
+
+	/* The opaque region last set on the parent surface, as a rectangle
+	 * with rounded corners. A width of 0 means there is none.
+	 */
+	int32_t opaque_x, opaque_y, opaque_w, opaque_h;
+	int32_t opaque_radii[4];
+
+	/* Scale of the last frame, and whether a buffer has been attached
+	 * to the current wl_surfaces yet.
+	 */
+	uint32_t scale;
+	bool     background_attached;
+	bool     text_attached;
+
+	/* When the output disappears, the surface is parked: The Wayland
+	 * surface is destroyed, but the buffers and caches are kept for a
+	 * while, in case an output with the same name comes back.
+	 */
+	struct wl_list  link;
+	char           *output_name;
+	uint64_t        parked_at;
 };
 
+/* How long and how many parked surfaces are kept. */
+#define PARKED_SURFACE_GRACE 60
+#define PARKED_SURFACES_MAX  4
+
 bool create_surface (struct Draw_output *output);
 void destroy_surface (struct Draw_surface *surface);
+void park_surface (struct Draw_surface *surface);
+void prune_parked_surfaces (struct App *app, bool all);
+int parked_surfaces_timeout (struct App *app);
+void schedule_frame (struct Draw_surface *surface);
+void surface_buffer_released (void *data);
+void get_text_area (struct Draw_surface *surface, int32_t *x, int32_t *y,
+		int32_t *w, int32_t *h);
 void update (struct App *app);
+void reconfigure_surfaces (struct App *app);
+void invalidate_surfaces (struct App *app);
+void drop_surface_caches (struct App *app);
+void suspend_surface (struct Draw_surface *surface);
+void resume_surface (struct Draw_surface *surface);
+bool surfaces_suspended (struct App *app);
 
 #endif
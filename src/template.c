@@ -0,0 +1,423 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<glob.h>
+#include<inttypes.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/timerfd.h>
+
+#include"wayout.h"
+#include"misc.h"
+#include"clock.h"
+#include"template.h"
+
+static const struct
+{
+	const char        *name;
+	enum Segment_type  type;
+	time_t             refresh;
+} sources[] = {
+	/* The refresh of the time is derived from its format. */
+	{ "time",   SEGMENT_TIME,    0  },
+	{ "bat",    SEGMENT_BATTERY, 30 },
+	{ "load1",  SEGMENT_LOAD1,   5  },
+	{ "load5",  SEGMENT_LOAD5,   5  },
+	{ "load15", SEGMENT_LOAD15,  5  },
+	{ "cpu",    SEGMENT_CPU,     2  },
+	{ "mem",    SEGMENT_MEMORY,  5  },
+	{ "file",   SEGMENT_FILE,    5  },
+};
+
+/* Reads a small file in one go, without stdio. Returns the length read
+ * without the trailing newline, or -1.
+ */
+static ssize_t read_small_file (const char *path, char *buffer, size_t size)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if ( fd == -1 )
+		return -1;
+	ssize_t len = read(fd, buffer, size - 1);
+	close(fd);
+	if ( len < 0 )
+		return -1;
+	if ( len > 0 && buffer[len-1] == '\n' )
+		len--;
+	buffer[len] = '\0';
+	return len;
+}
+
+static char *battery_path (const char *name)
+{
+	char path[256];
+	if ( name != NULL )
+	{
+		snprintf(path, sizeof(path), "/sys/class/power_supply/%s/capacity", name);
+		return strdup(path);
+	}
+
+	glob_t g;
+	char *ret = NULL;
+	if ( glob("/sys/class/power_supply/BAT*/capacity", 0, NULL, &g) == 0 )
+		ret = strdup(g.gl_pathv[0]);
+	globfree(&g);
+	return ret;
+}
+
+static bool add_segment (struct Template *template, enum Segment_type type,
+		const char *arg, size_t arg_len, time_t refresh)
+{
+	struct Segment *segments = realloc(template->segments,
+			(template->count + 1) * sizeof(struct Segment));
+	if ( segments == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		return false;
+	}
+	template->segments = segments;
+
+	struct Segment *segment = &segments[template->count++];
+	memset(segment, 0, sizeof(struct Segment));
+	segment->type    = type;
+	segment->arg     = arg == NULL ? NULL : strndup(arg, arg_len);
+	segment->refresh = refresh;
+	segment->next    = 0;
+
+	if ( type == SEGMENT_TIME )
+	{
+		if ( segment->arg == NULL )
+			segment->arg = strdup("%H:%M");
+		if ( segment->refresh == 0 )
+			segment->refresh = format_resolution(segment->arg);
+	}
+	else if ( type == SEGMENT_BATTERY )
+	{
+		char *path = battery_path(segment->arg);
+		free_if_set(segment->arg);
+		if ( NULL == (segment->arg = path) )
+			printlog(template->app, 1, "[template] No battery found.\n");
+	}
+	else if ( type == SEGMENT_FILE && segment->arg == NULL )
+	{
+		printlog(NULL, 0, "ERROR: {file} requires a path, e.g. {file:/tmp/status}.\n");
+		return false;
+	}
+	else if ( type == SEGMENT_LITERAL )
+	{
+		segment->len = arg_len;
+		memcpy(segment->value, arg, arg_len);
+	}
+	return true;
+}
+
+/* Parses "{name[:arg][@seconds]}" starting after the opening brace. */
+static bool compile_placeholder (struct Template *template, const char *str, size_t len)
+{
+	time_t refresh = 0;
+	const char *at = NULL;
+	for (const char *c = str + len - 1; c > str; c--)
+		if ( *c == '@' )
+		{
+			at = c;
+			break;
+		}
+		else if ( *c < '0' || *c > '9' )
+			break;
+	if ( at != NULL && at + 1 < str + len )
+	{
+		refresh = atoi(at + 1);
+		len     = (size_t)(at - str);
+	}
+
+	const char *colon = memchr(str, ':', len);
+	size_t name_len = colon == NULL ? len : (size_t)(colon - str);
+
+	for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++)
+		if ( strlen(sources[i].name) == name_len
+				&& ! strncmp(sources[i].name, str, name_len) )
+			return add_segment(template, sources[i].type,
+					colon == NULL ? NULL : colon + 1,
+					colon == NULL ? 0 : len - name_len - 1,
+					refresh > 0 ? refresh : sources[i].refresh);
+
+	printlog(NULL, 0, "ERROR: Unknown template source \"%.*s\".\n"
+			"INFO: Possible sources are 'time', 'bat', 'load1', 'load5', "
+			"'load15', 'cpu', 'mem' and 'file'.\n", (int)name_len, str);
+	return false;
+}
+
+static bool sample_segment (struct Segment *segment, time_t now)
+{
+	char buffer[4096];
+	char value[sizeof(segment->value)] = "";
+	ssize_t len;
+
+	switch (segment->type)
+	{
+		case SEGMENT_TIME:;
+			struct tm tm;
+			localtime_r(&now, &tm);
+			strftime(value, sizeof(value), segment->arg, &tm);
+			break;
+
+		case SEGMENT_BATTERY:
+		case SEGMENT_FILE:
+			if ( segment->arg != NULL
+					&& read_small_file(segment->arg, value, sizeof(value)) == -1 )
+				value[0] = '\0';
+			break;
+
+		case SEGMENT_LOAD1:
+		case SEGMENT_LOAD5:
+		case SEGMENT_LOAD15:;
+			char load[3][16];
+			if ( read_small_file("/proc/loadavg", buffer, sizeof(buffer)) != -1
+					&& sscanf(buffer, "%15s %15s %15s", load[0], load[1], load[2]) == 3 )
+				strcpy(value, load[segment->type - SEGMENT_LOAD1]);
+			break;
+
+		case SEGMENT_CPU:;
+			uint64_t user, nice, system, idle, iowait, irq, softirq, steal = 0;
+			if ( read_small_file("/proc/stat", buffer, sizeof(buffer)) == -1
+					|| sscanf(buffer, "cpu %" SCNu64 " %" SCNu64 " %" SCNu64
+						" %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+						" %" SCNu64, &user, &nice, &system, &idle, &iowait,
+						&irq, &softirq, &steal) < 7 )
+				break;
+			uint64_t total = user + nice + system + idle + iowait + irq + softirq + steal;
+			idle += iowait;
+			if ( total > segment->cpu_total )
+				snprintf(value, sizeof(value), "%d", (int)(100
+						- 100 * (idle - segment->cpu_idle)
+						/ (total - segment->cpu_total)));
+			segment->cpu_idle  = idle;
+			segment->cpu_total = total;
+			break;
+
+		case SEGMENT_MEMORY:;
+			const char *mem_total, *mem_available;
+			if ( read_small_file("/proc/meminfo", buffer, sizeof(buffer)) == -1
+					|| NULL == (mem_total = strstr(buffer, "MemTotal:"))
+					|| NULL == (mem_available = strstr(buffer, "MemAvailable:")) )
+				break;
+			long total_kb = atol(mem_total + strlen("MemTotal:"));
+			long available_kb = atol(mem_available + strlen("MemAvailable:"));
+			if ( total_kb > 0 )
+				snprintf(value, sizeof(value), "%ld",
+						100 - 100 * available_kb / total_kb);
+			break;
+
+		case SEGMENT_LITERAL:
+			return false;
+	}
+
+	len = (ssize_t)strlen(value);
+	if ( (size_t)len == segment->len && ! memcmp(value, segment->value, (size_t)len) )
+		return false;
+	memcpy(segment->value, value, (size_t)len + 1);
+	segment->len = (size_t)len;
+	return true;
+}
+
+/* Appends a sampled value, escaping the characters Pango markup treats
+ * specially. Returns false if it does not fit.
+ */
+static bool append_escaped (struct Template *template, const char *value, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		const char *escaped;
+		switch (value[i])
+		{
+			case '&':  escaped = "&amp;";  break;
+			case '<':  escaped = "&lt;";   break;
+			case '>':  escaped = "&gt;";   break;
+			case '\'': escaped = "&apos;"; break;
+			case '"':  escaped = "&quot;"; break;
+			default:   escaped = NULL;     break;
+		}
+		size_t escaped_len = escaped == NULL ? 1 : strlen(escaped);
+		if ( template->len + escaped_len >= sizeof(template->text) )
+			return false;
+		memcpy(template->text + template->len, escaped == NULL ? value + i : escaped,
+				escaped_len);
+		template->len += escaped_len;
+	}
+	return true;
+}
+
+/* Literals are part of the template and used as they are, sampled values,
+ * like the content of files, are escaped in markup.
+ */
+static void build_text (struct Template *template)
+{
+	template->len = 0;
+	for (size_t i = 0; i < template->count; i++)
+	{
+		struct Segment *segment = &template->segments[i];
+		if ( template->markup && segment->type != SEGMENT_LITERAL )
+		{
+			size_t len = template->len;
+			if (! append_escaped(template, segment->value, segment->len))
+			{
+				template->len = len;
+				break;
+			}
+			continue;
+		}
+		if ( template->len + segment->len >= sizeof(template->text) )
+			break;
+		memcpy(template->text + template->len, segment->value, segment->len);
+		template->len += segment->len;
+	}
+	template->text[template->len] = '\0';
+}
+
+/* Samples all segments which are due, then arms the timer for the next one.
+ * Returns true if any value changed.
+ */
+static bool sample_due (struct Template *template)
+{
+	time_t now = time(NULL), next = 0;
+	bool changed = false;
+
+	for (size_t i = 0; i < template->count; i++)
+	{
+		struct Segment *segment = &template->segments[i];
+		if ( segment->type == SEGMENT_LITERAL )
+			continue;
+		if ( segment->next <= now )
+		{
+			if (sample_segment(segment, now))
+				changed = true;
+
+			/* Aligning samples to multiples of their refresh lets
+			 * segments with related refreshes share wakeups. Only
+			 * hours and days are aligned in local time, any other
+			 * refresh of the time, like @300, is aligned like the
+			 * other sources.
+			 */
+			segment->next = segment->type == SEGMENT_TIME
+				&& ( segment->refresh == 3600 || segment->refresh == 86400 )
+				? next_boundary(now, segment->refresh)
+				: (now / segment->refresh + 1) * segment->refresh;
+		}
+		if ( next == 0 || segment->next < next )
+			next = segment->next;
+	}
+
+	if (changed)
+		build_text(template);
+
+	if ( next != 0 )
+	{
+		struct itimerspec timer_value = { 0 };
+		timer_value.it_value.tv_sec = next;
+		timerfd_settime(template->fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+				&timer_value, NULL);
+	}
+	return changed;
+}
+
+bool compile_template (struct Template *template, struct App *app, const char *str,
+		bool markup)
+{
+	template->app      = app;
+	template->markup   = markup;
+	template->segments = NULL;
+	template->count    = 0;
+	template->len      = 0;
+	template->text[0]  = '\0';
+
+	if ( -1 == (template->fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC)) )
+	{
+		printlog(NULL, 0, "ERROR: Unable to open timer fd.\n");
+		return false;
+	}
+
+	/* "{{" and "}}" are literal braces. */
+	char literal[sizeof(template->segments->value) - 1];
+	size_t literal_len = 0;
+	for (const char *c = str; *c != '\0'; c++)
+	{
+		if ( (*c == '{' && c[1] == '{') || (*c == '}' && c[1] == '}') )
+			c++;
+		else if ( *c == '{' )
+		{
+			const char *end = strchr(c, '}');
+			if ( end == NULL )
+			{
+				printlog(NULL, 0, "ERROR: Unterminated placeholder in template.\n");
+				return false;
+			}
+			if ( literal_len > 0 && ! add_segment(template, SEGMENT_LITERAL,
+						literal, literal_len, 0) )
+				return false;
+			literal_len = 0;
+			if (! compile_placeholder(template, c + 1, (size_t)(end - c - 1)))
+				return false;
+			c = end;
+			continue;
+		}
+		literal[literal_len++] = *c;
+		if ( literal_len == sizeof(literal) )
+		{
+			if (! add_segment(template, SEGMENT_LITERAL, literal, literal_len, 0))
+				return false;
+			literal_len = 0;
+		}
+	}
+	if ( literal_len > 0 && ! add_segment(template, SEGMENT_LITERAL,
+				literal, literal_len, 0) )
+		return false;
+
+	printlog(app, 1, "[template] Compiled \"%s\" into %zu segments.\n",
+			str, template->count);
+
+	sample_due(template);
+	build_text(template);
+	return true;
+}
+
+bool template_dispatch (struct Template *template)
+{
+	uint64_t expirations;
+	if ( read(template->fd, &expirations, sizeof(expirations)) == -1 )
+	{
+		if ( errno != ECANCELED )
+			return false;
+
+		/* The real time clock has been set; Sample everything. */
+		for (size_t i = 0; i < template->count; i++)
+			template->segments[i].next = 0;
+	}
+	tzset();
+	return sample_due(template);
+}
+
+/* Samples the time segments again, as their text and next boundary depend
+ * on the time zone. Returns true if any value changed.
+ */
+bool template_timezone_changed (struct Template *template)
+{
+	for (size_t i = 0; i < template->count; i++)
+		if ( template->segments[i].type == SEGMENT_TIME )
+			template->segments[i].next = 0;
+	return sample_due(template);
+}
+
+void finish_template (struct Template *template)
+{
+	if ( template->fd != -1 )
+		close(template->fd);
+	template->fd = -1;
+	for (size_t i = 0; i < template->count; i++)
+		free_if_set(template->segments[i].arg);
+	free_if_set(template->segments);
+	template->segments = NULL;
+	template->count    = 0;
+}
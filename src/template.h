@@ -0,0 +1,67 @@
+#ifndef WLCLOCK_TEMPLATE_H
+#define WLCLOCK_TEMPLATE_H
+
+#include<stdbool.h>
+#include<stddef.h>
+#include<stdint.h>
+#include<time.h>
+
+struct App;
+
+enum Segment_type
+{
+	SEGMENT_LITERAL,
+	SEGMENT_TIME,
+	SEGMENT_BATTERY,
+	SEGMENT_LOAD1,
+	SEGMENT_LOAD5,
+	SEGMENT_LOAD15,
+	SEGMENT_CPU,
+	SEGMENT_MEMORY,
+	SEGMENT_FILE,
+};
+
+struct Segment
+{
+	enum Segment_type type;
+
+	/* Literal text, time format or path, depending on the type. */
+	char *arg;
+
+	/* Seconds between two samples and the time of the next one. */
+	time_t refresh;
+	time_t next;
+
+	char   value[256];
+	size_t len;
+
+	/* Counters of the previous sample, for the CPU load. */
+	uint64_t cpu_idle, cpu_total;
+};
+
+/* A template like "{time:%H:%M} {bat}% {load1}" is compiled once into a list
+ * of segments. A single absolute timer wakes up when the next segment is
+ * due, and the text is only rebuilt when a value changed.
+ */
+struct Template
+{
+	struct App *app;
+	int         fd;
+
+	/* Sampled values are escaped if the text is markup. */
+	bool        markup;
+
+	struct Segment *segments;
+	size_t          count;
+
+	char   text[4096];
+	size_t len;
+};
+
+bool compile_template (struct Template *template, struct App *app, const char *str,
+		bool markup);
+bool template_dispatch (struct Template *template);
+bool template_timezone_changed (struct Template *template);
+void finish_template (struct Template *template);
+
+#endif
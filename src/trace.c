@@ -0,0 +1,65 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<unistd.h>
+
+#include"misc.h"
+#include"trace.h"
+
+struct Trace_span
+{
+	const char *name;
+	uint64_t    start, end;
+};
+
+/* wayout is single threaded, so a plain ring suffices. Names are string
+ * literals, so recording a span is two stores and an increment.
+ */
+static struct Trace_span spans[TRACE_SPANS];
+static uint64_t          span_count;
+
+void trace_record (const char *name, uint64_t start, uint64_t end)
+{
+	struct Trace_span *span = &spans[span_count++ % TRACE_SPANS];
+	span->name  = name;
+	span->start = start;
+	span->end   = end;
+}
+
+/* Writes the recorded spans as Chrome trace JSON, which chrome://tracing and
+ * Perfetto can open. Timestamps are microseconds of CLOCK_MONOTONIC.
+ */
+bool trace_export (const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if ( file == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Can not write trace \"%s\": %s\n",
+				path, strerror(errno));
+		return false;
+	}
+
+	uint64_t first = span_count > TRACE_SPANS ? span_count - TRACE_SPANS : 0;
+	long pid = (long)getpid();
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+	for (uint64_t i = first; i < span_count; i++)
+	{
+		struct Trace_span *span = &spans[i % TRACE_SPANS];
+		fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%ld,\"tid\":%ld,"
+				"\"ts\":%.3f,\"dur\":%.3f}\n",
+				i == first ? "" : ",", span->name, pid, pid,
+				(double)span->start / 1000.0,
+				(double)(span->end - span->start) / 1000.0);
+	}
+	fputs("]}\n", file);
+
+	if ( fclose(file) != 0 )
+	{
+		printlog(NULL, 0, "ERROR: Can not write trace \"%s\": %s\n",
+				path, strerror(errno));
+		return false;
+	}
+	return true;
+}
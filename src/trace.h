@@ -0,0 +1,36 @@
+#ifndef WLCLOCK_TRACE_H
+#define WLCLOCK_TRACE_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/* Spans are only recorded when built with the tracing option. Otherwise the
+ * macros expand to nothing, so they cost nothing either.
+ *
+ *	TRACE_BEGIN(draw_main);
+ *	...
+ *	TRACE_END(draw_main);
+ */
+#ifdef TRACING
+
+#include"misc.h"
+
+/* Number of spans kept, the oldest are overwritten. */
+#define TRACE_SPANS 65536
+
+#define TRACE_BEGIN(span) uint64_t trace_##span = monotonic_ns()
+#define TRACE_END(span) trace_record(#span, trace_##span, monotonic_ns())
+#define TRACE_RECORD(name, start, end) trace_record(name, start, end)
+
+void trace_record (const char *name, uint64_t start, uint64_t end);
+bool trace_export (const char *path);
+
+#else
+
+#define TRACE_BEGIN(span)
+#define TRACE_END(span)
+#define TRACE_RECORD(name, start, end)
+
+#endif
+
+#endif
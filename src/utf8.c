@@ -0,0 +1,170 @@
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+
+#include"utf8.h"
+
+/* Tabs and newlines are the only control characters kept. All others,
+ * including DEL and the C1 controls, are stripped.
+ */
+static bool is_control (uint32_t c)
+{
+	return ( c < 0x20 && c != '\t' && c != '\n' ) || ( c >= 0x7f && c < 0xa0 );
+}
+
+/* Decodes the code point at str. Returns its length, or 0 if the sequence
+ * is not valid UTF-8 (overlong, surrogate, out of range or truncated).
+ */
+static size_t decode (const uint8_t *str, size_t len, uint32_t *c)
+{
+	uint8_t b = str[0];
+	if ( b < 0x80 )
+	{
+		*c = b;
+		return 1;
+	}
+
+	size_t n;
+	uint8_t lo = 0x80, hi = 0xbf;
+	if ( b >= 0xc2 && b <= 0xdf )
+		n = 2, *c = b & 0x1f;
+	else if ( b >= 0xe0 && b <= 0xef )
+	{
+		n = 3, *c = b & 0x0f;
+		if ( b == 0xe0 )
+			lo = 0xa0;
+		else if ( b == 0xed )
+			hi = 0x9f;
+	}
+	else if ( b >= 0xf0 && b <= 0xf4 )
+	{
+		n = 4, *c = b & 0x07;
+		if ( b == 0xf0 )
+			lo = 0x90;
+		else if ( b == 0xf4 )
+			hi = 0x8f;
+	}
+	else
+		return 0;
+
+	if ( len < n || str[1] < lo || str[1] > hi )
+		return 0;
+	for (size_t i = 1; i < n; i++)
+	{
+		if ( (str[i] & 0xc0) != 0x80 )
+			return 0;
+		*c = (*c << 6) | (str[i] & 0x3f);
+	}
+	return n;
+}
+
+static bool is_special (uint8_t b)
+{
+	return b < 0x20 ? b != '\t' && b != '\n' : b >= 0x7f;
+}
+
+/* Returns the offset of the first byte at or after i which is not plain
+ * printable ASCII, tab or newline. Most text is entirely made of those, so
+ * they are skipped 16 (SSE2) or 8 bytes at a time.
+ */
+static size_t skip_ascii (const uint8_t *str, size_t len, size_t i)
+{
+#ifdef __SSE2__
+	const __m128i space = _mm_set1_epi8(0x20);
+	const __m128i del   = _mm_set1_epi8(0x7f);
+	const __m128i tab   = _mm_set1_epi8('\t');
+	const __m128i nl    = _mm_set1_epi8('\n');
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(str + i));
+
+		/* Bytes with the high bit set are negative as signed chars,
+		 * so a single comparison catches both them and controls.
+		 */
+		__m128i special = _mm_or_si128(_mm_cmplt_epi8(v, space),
+				_mm_cmpeq_epi8(v, del));
+		__m128i allowed = _mm_or_si128(_mm_cmpeq_epi8(v, tab),
+				_mm_cmpeq_epi8(v, nl));
+		int mask = _mm_movemask_epi8(_mm_andnot_si128(allowed, special));
+		if ( mask != 0 )
+			return i + (size_t)__builtin_ctz((unsigned)mask);
+	}
+#else
+	const uint64_t ones = 0x0101010101010101ULL, high = 0x8080808080808080ULL;
+	for (; i + 8 <= len; i += 8)
+	{
+		uint64_t v, d;
+		memcpy(&v, str + i, sizeof(v));
+
+		/* Detects any byte >= 0x80 or < 0x20, and any DEL. Tabs and
+		 * newlines also end up here and are sorted out bytewise.
+		 */
+		d = v ^ (ones * 0x7f);
+		if ( (((v - ones * 0x20) | v) & high) == 0
+				&& ((d - ones) & ~d & high) == 0 )
+			continue;
+		for (size_t j = i; j < i + 8; j++)
+			if ( is_special(str[j]) )
+				return j;
+	}
+#endif
+
+	for (; i < len; i++)
+		if (is_special(str[i]))
+			return i;
+	return len;
+}
+
+/* Returns the length of the longest prefix of str which is valid UTF-8 and
+ * free of control characters. Equal to len if the whole string is clean.
+ */
+size_t utf8_clean_prefix (const char *str, size_t len)
+{
+	const uint8_t *s = (const uint8_t *)str;
+	size_t i = 0;
+	while ( (i = skip_ascii(s, len, i)) < len )
+	{
+		uint32_t c;
+		size_t n = decode(s + i, len - i, &c);
+		if ( n == 0 || is_control(c) )
+			return i;
+		i += n;
+	}
+	return len;
+}
+
+/* Writes a sanitised copy of in to out, which must have room for
+ * UTF8_SANITISE_FACTOR times len bytes. Invalid bytes are replaced by
+ * U+FFFD, control characters are stripped. Returns the new length; out is
+ * not NUL terminated.
+ */
+size_t utf8_sanitise (char *out, const char *in, size_t len)
+{
+	const uint8_t *s = (const uint8_t *)in;
+	size_t i = 0, o = 0;
+	while ( i < len )
+	{
+		size_t clean = utf8_clean_prefix(in + i, len - i);
+		memcpy(out + o, in + i, clean);
+		i += clean;
+		o += clean;
+		if ( i == len )
+			break;
+
+		uint32_t c;
+		size_t n = decode(s + i, len - i, &c);
+		if ( n == 0 )
+		{
+			memcpy(out + o, "\xef\xbf\xbd", 3);
+			o += 3;
+			i++;
+		}
+		else
+			i += n;
+	}
+	return o;
+}
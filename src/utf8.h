@@ -0,0 +1,14 @@
+#ifndef WLCLOCK_UTF8_H
+#define WLCLOCK_UTF8_H
+
+#include<stddef.h>
+
+/* Sanitising never grows the text by more than this factor, as every
+ * invalid byte is replaced by U+FFFD, which takes three bytes.
+ */
+#define UTF8_SANITISE_FACTOR 3
+
+size_t utf8_clean_prefix (const char *str, size_t len);
+size_t utf8_sanitise (char *out, const char *in, size_t len);
+
+#endif
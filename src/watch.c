@@ -0,0 +1,128 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<string.h>
+#include<errno.h>
+#include<libgen.h>
+#include<unistd.h>
+#include<sys/inotify.h>
+#include<sys/vfs.h>
+
+#include"wayout.h"
+#include"misc.h"
+#include"watch.h"
+#include"scheduler.h"
+
+#define SYSFS_MAGIC      0x62656572
+#define PROC_SUPER_MAGIC 0x9fa0
+
+static bool needs_polling (const char *path)
+{
+	struct statfs st;
+	if ( statfs(path, &st) == -1 )
+		return false;
+	return st.f_type == SYSFS_MAGIC || st.f_type == PROC_SUPER_MAGIC;
+}
+
+static bool init_polling (struct Watch *watch, int32_t interval)
+{
+	watch->polling  = true;
+	watch->interval = (uint64_t)interval * 1000000;
+	watch->fd = create_interval_timer(watch->app->low_power, watch->interval);
+	return watch->fd != -1;
+}
+
+bool init_watch (struct Watch *watch, struct App *app, const char *path,
+		int32_t interval)
+{
+	watch->app     = app;
+	watch->fd      = -1;
+	watch->polling = false;
+	watch->loaded  = false;
+
+	/* dirname() and basename() may modify their argument. */
+	char *dir_buffer = strdup(path), *base_buffer = strdup(path);
+	watch->base = strdup(basename(base_buffer));
+	char *dir   = dirname(dir_buffer);
+	free(base_buffer);
+
+	bool ret;
+	if (needs_polling(path))
+	{
+		printlog(app, 1, "[watch] Polling \"%s\" every %dms.\n", path, interval);
+		ret = init_polling(watch, interval);
+	}
+	else if ( -1 == (watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) )
+	{
+		printlog(app, 1, "[watch] inotify unavailable, polling \"%s\".\n", path);
+		ret = init_polling(watch, interval);
+	}
+	else
+	{
+		/* Watching the directory instead of the file itself also
+		 * catches writers which atomically replace the file.
+		 */
+		printlog(app, 1, "[watch] Watching \"%s\".\n", path);
+		ret = inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE | IN_MODIFY
+				| IN_MOVED_TO | IN_CREATE | IN_DELETE) != -1;
+		if (! ret)
+			printlog(NULL, 0, "ERROR: Can not watch \"%s\": %s\n",
+					dir, strerror(errno));
+	}
+
+	free(dir_buffer);
+	return ret;
+}
+
+/* Returns true if the content differs from the one last passed to this
+ * function.
+ */
+bool watch_content_changed (struct Watch *watch, const char *content, size_t len)
+{
+	/* FNV-1a */
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ (uint8_t)content[i]) * 0x100000001b3;
+
+	if ( watch->loaded && watch->content_len == len && watch->content_hash == hash )
+		return false;
+	watch->loaded       = true;
+	watch->content_len  = len;
+	watch->content_hash = hash;
+	return true;
+}
+
+/* Returns true if the file may have changed. */
+bool watch_dispatch (struct Watch *watch)
+{
+	if (watch->polling)
+	{
+		uint64_t elapsed;
+		return read_interval_timer(watch->fd, watch->app->low_power,
+				watch->interval, &elapsed);
+	}
+
+	_Alignas(struct inotify_event) char buffer[4096];
+	bool changed = false;
+	ssize_t len;
+	while ( (len = read(watch->fd, buffer, sizeof(buffer))) > 0 )
+	{
+		for (char *ptr = buffer; ptr < buffer + len; )
+		{
+			const struct inotify_event *event = (const struct inotify_event *)ptr;
+			if ( event->len > 0 && ! strcmp(event->name, watch->base) )
+				changed = true;
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+	}
+	return changed;
+}
+
+void finish_watch (struct Watch *watch)
+{
+	if ( watch->fd != -1 )
+		close(watch->fd);
+	watch->fd = -1;
+	free_if_set(watch->base);
+	watch->base = NULL;
+}
@@ -0,0 +1,36 @@
+#ifndef WLCLOCK_WATCH_H
+#define WLCLOCK_WATCH_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+struct App;
+
+/* Watches a file for changes. Files in sysfs and procfs do not emit inotify
+ * events, so they are polled at a fixed interval instead.
+ */
+struct Watch
+{
+	struct App *app;
+
+	/* inotify fd watching the parent directory, or timerfd when polling. */
+	int      fd;
+	bool     polling;
+	uint64_t interval;
+
+	/* Length and hash of the raw content last loaded, as the text of
+	 * the pane may have been sanitised.
+	 */
+	bool     loaded;
+	size_t   content_len;
+	uint64_t content_hash;
+	char *base;
+};
+
+bool init_watch (struct Watch *watch, struct App *app, const char *path,
+		int32_t interval);
+bool watch_dispatch (struct Watch *watch);
+bool watch_content_changed (struct Watch *watch, const char *content, size_t len);
+void finish_watch (struct Watch *watch);
+
+#endif
@@ -1,4 +1,5 @@
 #include<errno.h>
+#include<fcntl.h>
 #include<getopt.h>
 #include<poll.h>
 #include<stdbool.h>
@@ -6,11 +7,11 @@
 #include<stdlib.h>
 #include<string.h>
 #include<unistd.h>
+#include<time.h>
 #ifdef HANDLE_SIGNALS
 #include<sys/signalfd.h>
 #include<signal.h>
 #endif
-#include <sys/timerfd.h>
 
 #include<wayland-server.h>
 #include<wayland-client.h>
@@ -19,14 +20,19 @@
 #include"wlr-layer-shell-unstable-v1-protocol.h"
 #include"xdg-output-unstable-v1-protocol.h"
 #include"xdg-shell-protocol.h"
+#include"wlr-output-power-management-unstable-v1-protocol.h"
+#include"ext-idle-notify-v1-protocol.h"
+#include"presentation-time-protocol.h"
 
 #include"wayout.h"
 #include"misc.h"
 #include"output.h"
 #include"surface.h"
 #include"colour.h"
-
-#define BUFFERSIZE 65536
+#include"pane.h"
+#include"control.h"
+#include"trace.h"
+#include"presentation.h"
 
 static void registry_handle_global (void *data, struct wl_registry *registry,
 		uint32_t name, const char *interface, uint32_t version)
@@ -38,7 +44,7 @@ static void registry_handle_global (void *data, struct wl_registry *registry,
 		printlog(app, 2, "[main] Get wl_compositor.\n");
 		app->compositor = wl_registry_bind(registry, name, &wl_compositor_interface, 4);
 	}
-	if (! strcmp(interface, wl_subcompositor_interface.name))
+	else if (! strcmp(interface, wl_subcompositor_interface.name))
 	{
 		printlog(app, 2, "[main] Get wl_subcompositor.\n");
 		app->subcompositor = wl_registry_bind(registry, name,
@@ -59,6 +65,29 @@ static void registry_handle_global (void *data, struct wl_registry *registry,
 		printlog(app, 2, "[main] Get zxdg_output_manager_v1.\n");
 		app->xdg_output_manager = wl_registry_bind(registry, name, &zxdg_output_manager_v1_interface, 3);
 	}
+	else if ( app->track_power
+			&& ! strcmp(interface, zwlr_output_power_manager_v1_interface.name) )
+	{
+		printlog(app, 2, "[main] Get zwlr_output_power_manager_v1.\n");
+		app->output_power_manager = wl_registry_bind(registry, name,
+				&zwlr_output_power_manager_v1_interface, 1);
+	}
+	else if (! strcmp(interface, ext_idle_notifier_v1_interface.name))
+	{
+		printlog(app, 2, "[main] Get ext_idle_notifier_v1.\n");
+		app->idle_notifier = wl_registry_bind(registry, name,
+				&ext_idle_notifier_v1_interface, 1);
+	}
+	else if (! strcmp(interface, wp_presentation_interface.name))
+	{
+		printlog(app, 2, "[main] Get wp_presentation.\n");
+		init_presentation(app, registry, name);
+	}
+	else if ( ! strcmp(interface, wl_seat_interface.name) && app->seat == NULL )
+	{
+		printlog(app, 2, "[main] Get wl_seat.\n");
+		app->seat = wl_registry_bind(registry, name, &wl_seat_interface, 1);
+	}
 	else if (! strcmp(interface, wl_output_interface.name))
 	{
 		if (! create_output(data, registry, name, interface, version))
@@ -84,6 +113,35 @@ static const struct wl_registry_listener registry_listener = {
 	.global_remove = registry_handle_global_remove
 };
 
+static void idle_notification_handle_idled (void *data,
+		struct ext_idle_notification_v1 *notification)
+{
+	struct App *app = (struct App *)data;
+	printlog(app, 1, "[main] Session idle; Suspending.\n");
+	app->idle = true;
+	struct Draw_output *op;
+	wl_list_for_each(op, &app->outputs, link)
+		if ( op->surface != NULL )
+			suspend_surface(op->surface);
+}
+
+static void idle_notification_handle_resumed (void *data,
+		struct ext_idle_notification_v1 *notification)
+{
+	struct App *app = (struct App *)data;
+	printlog(app, 1, "[main] Session active; Resuming.\n");
+	app->idle = false;
+	struct Draw_output *op;
+	wl_list_for_each(op, &app->outputs, link)
+		if ( op->surface != NULL )
+			resume_surface(op->surface);
+}
+
+static const struct ext_idle_notification_v1_listener idle_notification_listener = {
+	.idled   = idle_notification_handle_idled,
+	.resumed = idle_notification_handle_resumed,
+};
+
 /* Helper function for capability support error message. */
 static bool capability_test (void *ptr, const char *name)
 {
@@ -93,6 +151,61 @@ static bool capability_test (void *ptr, const char *name)
 	return false;
 }
 
+/* Called once the compositor has processed the registry request, at which
+ * point all globals present at startup have been announced.
+ */
+static void registry_handle_done (void *data, struct wl_callback *callback,
+		uint32_t serial)
+{
+	struct App *app = (struct App *)data;
+	wl_callback_destroy(callback);
+	app->timing.globals = monotonic_ns();
+
+	/* Testing compatibilities. */
+	if ( ! capability_test(app->compositor, "wl_compositor")
+			|| ! capability_test(app->subcompositor, "wl_subcompositor")
+			|| ! capability_test(app->shm, "wl_shm")
+			|| ! capability_test(app->layer_shell, "zwlr_layer_shell")
+			|| ! capability_test(app->xdg_output_manager, "xdg_output_manager") )
+		goto error;
+
+	printlog(app, 2, "[main] Catching up on output configuration.\n");
+	struct Draw_output *op;
+	wl_list_for_each(op, &app->outputs, link)
+	{
+		if ( ! op->configured && ! configure_output(op) )
+			goto error;
+		output_track_power(op);
+	}
+
+	if ( app->idle_timeout > 0 )
+	{
+		if ( app->idle_notifier != NULL && app->seat != NULL )
+		{
+			app->idle_notification = ext_idle_notifier_v1_get_idle_notification(
+					app->idle_notifier, app->idle_timeout, app->seat);
+			ext_idle_notification_v1_add_listener(app->idle_notification,
+					&idle_notification_listener, app);
+		}
+		else
+			printlog(NULL, 0, "WARNING: Wayland compositor does not support "
+					"ext_idle_notifier_v1; Not suspending when idle.\n");
+	}
+
+	return;
+error:
+	app->loop = false;
+	app->ret  = EXIT_FAILURE;
+}
+
+static const struct wl_callback_listener registry_done_listener = {
+	.done = registry_handle_done,
+};
+
+/* Connects to the compositor without waiting for it. The globals are bound
+ * and checked from within the event loop, so the compositor answering the
+ * initial requests overlaps with loading fonts and reading the input.
+ */
 static bool init_wayland (struct App *app)
 {
 	printlog(app, 1, "[main] Init Wayland.\n");
@@ -104,6 +217,7 @@ static bool init_wayland (struct App *app)
 		printlog(NULL, 0, "ERROR: Can not connect to a Wayland server.\n");
 		return false;
 	}
+	app->timing.connected = monotonic_ns();
 
 	/* Get registry and add listeners. */
 	printlog(app, 2, "[main] Get wl_registry.\n");
@@ -112,29 +226,14 @@ static bool init_wayland (struct App *app)
 	wl_registry_add_listener(app->registry, &registry_listener, app);
 
 	/* Allow registry listeners to catch up. */
-	//TODO use sync instead
-	if ( wl_display_roundtrip(app->display) == -1 )
+	struct wl_callback *callback = wl_display_sync(app->display);
+	wl_callback_add_listener(callback, &registry_done_listener, app);
+	if ( wl_display_flush(app->display) == -1 )
 	{
-		printlog(NULL, 0, "ERROR: Roundtrip failed.\n");
+		printlog(NULL, 0, "ERROR: wl_display_flush: %s\n", strerror(errno));
 		return false;
 	}
 
-	/* Testing compatibilities. */
-	if (! capability_test(app->compositor, "wl_compositor"))
-		return false;
-	if (! capability_test(app->shm, "wl_shm"))
-		return false;
-	if (! capability_test(app->layer_shell, "zwlr_layer_shell"))
-		return false;
-	if (! capability_test(app->xdg_output_manager, "xdg_output_manager"))
-		return false;
-
-	printlog(app, 2, "[main] Catching up on output configuration.\n");
-	struct Draw_output *op;
-	wl_list_for_each(op, &app->outputs, link)
-		if ( ! op->configured && ! configure_output(op) )
-			return false;
-
 	return true;
 }
 
@@ -149,8 +248,19 @@ static void finish_wayland (struct App *app)
 	destroy_all_outputs(app);
 
 	printlog(app, 2, "[main] Destroying Wayland objects.\n");
+	finish_presentation(app);
+	if ( app->idle_notification != NULL )
+		ext_idle_notification_v1_destroy(app->idle_notification);
+	if ( app->idle_notifier != NULL )
+		ext_idle_notifier_v1_destroy(app->idle_notifier);
+	if ( app->output_power_manager != NULL )
+		zwlr_output_power_manager_v1_destroy(app->output_power_manager);
+	if ( app->seat != NULL )
+		wl_seat_destroy(app->seat);
 	if ( app->layer_shell != NULL )
 		zwlr_layer_shell_v1_destroy(app->layer_shell);
+	if ( app->subcompositor != NULL )
+		wl_subcompositor_destroy(app->subcompositor);
 	if ( app->compositor != NULL )
 		wl_compositor_destroy(app->compositor);
 	if ( app->shm != NULL )
@@ -174,7 +284,6 @@ static bool handle_command_flags (struct App *app, int argc, char *argv[])
 		"      --background-colour [#rgba] Background colour.\n"
 		"      --border-colour [#rgba]     Border colour.\n"
 		"      --border-size [px]          Size of the border.\n"
-		"      --text-colour [#rgba]       Colour of the text.\n"
 		"      --corner-radius [px]        Corner radii.\n"
 		"      --exclusive-zone            Exclusive zone of the layer surface.\n"
 		"      --layer [top,bottom,overlay,background]\n"
@@ -186,13 +295,37 @@ static bool handle_command_flags (struct App *app, int argc, char *argv[])
 		"      --position                  Set the position of the widget.\n"
 		"      --width [px]                Set the width of the widget.\n"
 		"      --height [px]               Set the height of the widget.\n"
+		"  -i, --interval [ms]             Poll interval to check for new input\n"
+		"      --control [path]            Accept commands on a Unix socket\n"
+		"      --suspend-idle [s]          Stop rendering after s seconds without input\n"
+		"      --low-power                 Coalesce wakeups with other processes\n"
+		"      --track-output-power        Stop rendering on outputs which are off\n"
+		"      --timing                    Report where the time until the first frame went\n"
+		"      --stats-file [path]         Periodically write statistics to a file\n"
+		"      --stats-interval [s]        Interval for --stats-file, default 10\n"
+		"      --trace [path]              Write a Chrome trace at exit (tracing builds)\n"
+		"\n"
+		"Pane options (apply to the last --pane, or to all panes if given before):\n"
+		"      --pane [name:x,y,w,h]       Add a pane; The rectangle is relative to\n"
+		"                                  the area inside the border, 0 extends it\n"
+		"                                  to the edge\n"
+		"      --pane-input [path]         Read the pane from a file or FIFO instead\n"
+		"                                  of stdin lines tagged \"name<tab>\"\n"
+		"      --watch-file [path]         Show a file, re-read whenever it changes\n"
+		"      --clock [format]            Show the time in a strftime() format\n"
+		"      --template [template]       Show built-in sources, e.g. \"{cpu}% {mem}%\"\n"
+		"      --pane-background [#rgba]   Background colour of the pane.\n"
+		"      --text-colour [#rgba]       Colour of the text.\n"
 		"      --font [font pattern]       Font pattern (e.g. Monospace 23)\n"
 		"      --center                    Center alignment (horizontally)\n"
 		"  -w, --no-wrap                   Disable wordwrap\n"
 		"  -l, --feed-line                 Each line delimits the input\n"
 		"  -p, --feed-par                  Empty lines delimit the input\n"
 		"  -d, --feed-delimiter [line]     A custom delimiter delimits the input\n"
-		"  -i, --interval [ms]             Poll interval to check for new input\n"
+		"      --feed-framed               Length-prefixed binary frames (see wayout(1))\n"
+		"      --tail [lines]              Show the last lines of the input, scrolling\n"
+		"      --ansi                      Colours from ANSI escape codes instead of markup\n"
+		"      --document                  Show a large input as a scrollable document\n"
 		"\n";
 
 	int i;
@@ -215,38 +348,8 @@ static bool handle_command_flags (struct App *app, int argc, char *argv[])
 			app->dimensions.h    = atoi(argv[++i]);
 		} else if (!strcmp(argv[i],"--position")) {
 			if (i + 1 >= argc) goto error;
-			if (! strcmp(argv[i+1], "center"))
-				app->anchor = 0;
-			else if (! strcmp(argv[i+1], "top"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP;
-			else if (! strcmp(argv[i+1], "right"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
-			else if (! strcmp(argv[i+1], "bottom"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM;
-			else if (! strcmp(argv[i+1], "left"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT;
-			else if (! strcmp(argv[i+1], "top-left"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP
-					| ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT;
-			else if (! strcmp(argv[i+1], "top-right"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_TOP
-					| ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
-			else if (! strcmp(argv[i+1], "bottom-left"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM
-					| ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT;
-			else if (! strcmp(argv[i+1], "bottom-right"))
-				app->anchor = ZWLR_LAYER_SURFACE_V1_ANCHOR_BOTTOM
-					| ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
-			else
-			{
-				printlog(NULL, 0, "ERROR: Unrecognized position \"%s\".\n"
-						"INFO: Possible positisions are 'center', "
-						"'top', 'right', 'bottom', 'left', "
-						"'top-right', 'top-left', 'bottom-right', 'bottom-left'.\n",
-						optarg);
+			if (! anchor_from_string(&app->anchor, argv[++i]))
 				return false;
-			}
-			i++;
 		} else if (!strcmp(argv[i],"--background-colour") || !strcmp(argv[i],"--background-color")) {
 			if (i + 1 >= argc) goto error;
 			if (! colour_from_string(&app->background_colour, argv[++i]))
@@ -268,8 +371,48 @@ static bool handle_command_flags (struct App *app, int argc, char *argv[])
 			}
 		} else if (!strcmp(argv[i],"--text-colour") || !strcmp(argv[i],"--text-color") || !strcmp(argv[i],"--foreground-colour") || !strcmp(argv[i],"--foreground-color")) {
 			if (i + 1 >= argc) goto error;
-			if (! colour_from_string(&app->text_colour, argv[++i]))
+			if (! colour_from_string(&app->pane->text_colour, argv[++i]))
+				return false;
+		} else if (!strcmp(argv[i],"--pane-background")) {
+			if (i + 1 >= argc) goto error;
+			if (! colour_from_string(&app->pane->background_colour, argv[++i]))
+				return false;
+		} else if (!strcmp(argv[i],"--pane")) {
+			if (i + 1 >= argc) goto error;
+			/* The first pane is the implicit one every widget has. */
+			char *name = argv[++i], *geometry = strchr(name, ':');
+			if ( geometry != NULL )
+				*geometry++ = '\0';
+			if ( get_pane_from_name(app, name) != NULL )
+			{
+				printlog(NULL, 0, "ERROR: Duplicate pane \"%s\".\n", name);
+				return false;
+			}
+			if ( app->pane->name != NULL )
+			{
+				if ( create_pane(app, name) == NULL )
+					return false;
+			}
+			else
+				set_string(&app->pane->name, name);
+			if ( geometry != NULL && ! pane_set_geometry(app->pane, geometry) )
 				return false;
+		} else if (!strcmp(argv[i],"--pane-input")) {
+			if (i + 1 >= argc) goto error;
+			set_string(&app->pane->path, argv[++i]);
+			app->pane->source = PANE_SOURCE_INPUT;
+		} else if (!strcmp(argv[i],"--watch-file")) {
+			if (i + 1 >= argc) goto error;
+			set_string(&app->pane->path, argv[++i]);
+			app->pane->source = PANE_SOURCE_WATCH;
+		} else if (!strcmp(argv[i],"--clock")) {
+			if (i + 1 >= argc) goto error;
+			set_string(&app->pane->path, argv[++i]);
+			app->pane->source = PANE_SOURCE_CLOCK;
+		} else if (!strcmp(argv[i],"--template")) {
+			if (i + 1 >= argc) goto error;
+			set_string(&app->pane->path, argv[++i]);
+			app->pane->source = PANE_SOURCE_TEMPLATE;
 		} else if (!strcmp(argv[i],"--exclusive-zone")) {
 			if (i + 1 >= argc) goto error;
 			if (is_boolean_true(argv[i+1]))
@@ -351,37 +494,100 @@ static bool handle_command_flags (struct App *app, int argc, char *argv[])
 				return false;
 			}
 		} else if (!strcmp(argv[i],"-l") || !strcmp(argv[i],"--feed-line")) {
-            app->feed = true;
-            app->delimiter = "";
+            app->pane->input.feed = true;
+            app->pane->input.delimiter = NULL;
+            app->pane->input.framed = false;
 		} else if (!strcmp(argv[i],"-p") || !strcmp(argv[i],"--feed-par")) {
-            app->feed = true;
-            app->delimiter = "\n";
+            app->pane->input.feed = true;
+            app->pane->input.delimiter = "\n";
+            app->pane->input.framed = false;
 		} else if (!strcmp(argv[i],"-d") || !strcmp(argv[i],"--feed-delimiter")) {
 			if (i + 1 >= argc) goto error;
-            app->feed = true;
-            app->delimiter = argv[++i];
+            app->pane->input.feed = true;
+            app->pane->input.delimiter = argv[++i];
+            app->pane->input.framed = false;
+		} else if (!strcmp(argv[i],"--feed-framed")) {
+            app->pane->input.feed = true;
+            app->pane->input.framed = true;
+		} else if (!strcmp(argv[i],"--tail")) {
+			if (i + 1 >= argc) goto error;
+			int tail = atoi(argv[++i]);
+			if ( tail <= 0 )
+			{
+				printlog(NULL, 0, "ERROR: The tail must have at least one line.\n");
+				return false;
+			}
+			app->pane->tail = (size_t)tail;
+            app->pane->input.feed = true;
+            app->pane->input.delimiter = NULL;
+            app->pane->input.framed = false;
+		} else if (!strcmp(argv[i],"--document")) {
+			app->pane->document = true;
+			app->pane->tail     = 0;
+			app->pane->input.feed = false;
+		} else if (!strcmp(argv[i],"--ansi")) {
+			app->pane->ansi   = true;
+			app->pane->markup = false;
 		} else if (!strcmp(argv[i],"-i") || !strcmp(argv[i],"--interval")) {
 			if (i + 1 >= argc) goto error;
             app->interval = atoi(argv[++i]);
+		} else if (!strcmp(argv[i],"--timing")) {
+			app->timing.enabled = true;
+		} else if (!strcmp(argv[i],"--stats-file")) {
+			if (i + 1 >= argc) goto error;
+			set_string(&app->stats.path, argv[++i]);
+		} else if (!strcmp(argv[i],"--trace")) {
+			if (i + 1 >= argc) goto error;
+#ifdef TRACING
+			set_string(&app->trace_path, argv[++i]);
+#else
+			printlog(NULL, 0, "ERROR: wayout was built without tracing.\n");
+			return false;
+#endif
+		} else if (!strcmp(argv[i],"--stats-interval")) {
+			if (i + 1 >= argc) goto error;
+			app->stats.interval = atoi(argv[++i]);
+			if ( app->stats.interval <= 0 )
+			{
+				printlog(NULL, 0, "ERROR: The statistics interval must be positive.\n");
+				return false;
+			}
+		} else if (!strcmp(argv[i],"--suspend-idle")) {
+			if (i + 1 >= argc) goto error;
+			int timeout = atoi(argv[++i]);
+			if ( timeout <= 0 )
+			{
+				printlog(NULL, 0, "ERROR: The idle timeout must be positive.\n");
+				return false;
+			}
+			app->idle_timeout = (uint32_t)timeout * 1000;
+		} else if (!strcmp(argv[i],"--low-power")) {
+			app->low_power = true;
+		} else if (!strcmp(argv[i],"--track-output-power")) {
+			app->track_power = true;
+		} else if (!strcmp(argv[i],"--control")) {
+			if (i + 1 >= argc) goto error;
+			set_string(&app->control.path, argv[++i]);
 		} else if (!strcmp(argv[i],"--font")) {
 			if (i + 1 >= argc) goto error;
-			app->font_pattern = strdup(argv[++i]);
+			set_string(&app->pane->font_pattern, argv[++i]);
 		} else if (!strcmp(argv[i],"--fontsize")) {
 			//added for backward compatibility
 			if (i + 1 >= argc) goto error;
-			char * target = malloc(strlen(app->font_pattern) + 10);
-			sprintf(target, "%s %s", app->font_pattern, argv[++i]);
-			app->font_pattern = target;
+			char * target = malloc(strlen(app->pane->font_pattern) + strlen(argv[i+1]) + 2);
+			sprintf(target, "%s %s", app->pane->font_pattern, argv[++i]);
+			free(app->pane->font_pattern);
+			app->pane->font_pattern = target;
 		} else if (!strcmp(argv[i],"--textalign")) {
 			//added for backward compatibility
 			if (i + 1 >= argc) goto error;
 			if (!strcmp(argv[++i],"center")) {
-				app->center = true;
+				app->pane->center = true;
 			}
 		} else if (!strcmp(argv[i],"-w") || !strcmp(argv[i],"--no-wrap")) {
-			app->wordwrap = false;
+			app->pane->wordwrap = false;
 		} else if (!strcmp(argv[i],"--center")) {
-			app->center = true;
+			app->pane->center = true;
 		} else {
 			printlog(app, 0, "Invalid parameter: %s", argv[i]);
 			return false;
@@ -395,19 +601,87 @@ static bool handle_command_flags (struct App *app, int argc, char *argv[])
 
 
 
-/* Timeout until next update */
+/* Returns true if any of the panes is a feed, which is rendered at the pace
+ * of the interval timer.
+ */
+static bool has_feed (struct App *app)
+{
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+		if (pane->input.feed)
+			return true;
+	return false;
+}
+
+static bool has_clock (struct App *app)
+{
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+		if ( pane->source == PANE_SOURCE_CLOCK || pane->source == PANE_SOURCE_TEMPLATE )
+			return true;
+	return false;
+}
+
+static bool has_dirty_pane (struct App *app)
+{
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app->panes, link)
+		if (pane->dirty)
+			return true;
+	return false;
+}
+
+/* Dispatches the Wayland events which arrived since poll() returned,
+ * without blocking. Used before rendering while overloaded, so a slow
+ * frame does not delay the events any further.
+ */
+static bool dispatch_wayland_events (struct App *app)
+{
+	struct pollfd fd = { .fd = wl_display_get_fd(app->display), .events = POLLIN };
+	if ( poll(&fd, 1, 0) <= 0 || ! (fd.revents & POLLIN) )
+		return true;
+	if ( wl_display_dispatch(app->display) == -1 )
+	{
+		printlog(NULL, 0, "ERROR: wl_display_dispatch: %s\n", strerror(errno));
+		return false;
+	}
+	return true;
+}
 
 static void app_run (struct App *app)
 {
 	printlog(app, 1, "[main] Starting loop.\n");
 	app->ret = EXIT_SUCCESS;
 
-	struct pollfd fds[4] = { 0 };
+	/* The fixed fds come first, followed by one fd per pane, in the
+	 * order of app->panes. Panes without an open input have an fd of -1,
+	 * which poll() ignores.
+	 */
 	size_t wayland_fd = 0;
-	size_t stdin_fd = 1;
-	size_t timer_fd = 2;
-	size_t signal_fd = 3;
-	size_t fd_count = 4;
+	size_t timer_fd = 1;
+	size_t signal_fd = 2;
+	size_t control_fd = 3;
+	size_t stats_fd = 4;
+	size_t timezone_fd = 5;
+	size_t client_fds = 6;
+	size_t pane_fds = client_fds + CONTROL_MAX_CLIENTS;
+	size_t fd_count = pane_fds + (size_t)wl_list_length(&app->panes);
+	struct Draw_pane *pane;
+
+	/* Memory is measured whenever the statistics are written, and after
+	 * buffers were created, which is where the peaks come from.
+	 */
+	uint64_t buffers_measured = 0;
+
+	struct pollfd *fds = calloc(fd_count, sizeof(struct pollfd));
+	if ( fds == NULL )
+	{
+		printlog(NULL, 0, "ERROR: Could not allocate.\n");
+		app->ret = EXIT_FAILURE;
+		return;
+	}
+	for (size_t i = 0; i < fd_count; i++)
+		fds[i].fd = -1;
 
 	fds[wayland_fd].events = POLLIN;
 	if ( -1 ==  (fds[wayland_fd].fd = wl_display_get_fd(app->display)) )
@@ -416,35 +690,18 @@ static void app_run (struct App *app)
 		goto error;
 	}
 
-	fds[stdin_fd].events = POLLIN;
-	fds[stdin_fd].fd = STDIN_FILENO;
-	if ( 0 > (fds[stdin_fd].fd = STDIN_FILENO)) {
-		printlog(NULL, 0, "ERROR: Unable to open stdin fd.\n");
-		goto error;
+	if (has_clock(app))
+	{
+		fds[timezone_fd].fd = open_timezone_watch(app);
+		fds[timezone_fd].events = POLLIN;
 	}
 
-	if (app->feed) {
-		struct itimerspec timer_value;
+	if (has_feed(app)) {
 		fds[timer_fd].events = POLLIN;
-		if ( 0 > (fds[timer_fd].fd = timerfd_create(CLOCK_MONOTONIC, 0))) {
-			printlog(NULL, 0, "ERROR: Unable to open timer fd.\n");
+		if (! start_scheduler(&app->scheduler, app->interval, app->low_power))
 			goto error;
-		}
-		memset(&timer_value, 0, sizeof(timer_value));
-		timer_value.it_value.tv_sec = timer_value.it_interval.tv_sec = floor((double) app->interval / 1000.0);
-		timer_value.it_value.tv_nsec = timer_value.it_interval.tv_nsec = floor(app->interval % 1000) * 1000000; //ms to ns
-
-		if (timerfd_settime(fds[timer_fd].fd, 0, &timer_value, NULL) < 0) {
-			printlog(NULL, 0, "ERROR: Unable to start timer.\n");
-			goto error;
-		}
-	} else {
-		fds[timer_fd].fd = -1;
-		fds[timer_fd].events = -1;
-		fds[timer_fd].revents = -1;
 	}
 
-
 #ifdef HANDLE_SIGNALS
 	sigset_t mask;
 	struct signalfd_siginfo fdsi;
@@ -468,10 +725,6 @@ static void app_run (struct App *app)
 	}
 #endif
 
-	char buffer[BUFFERSIZE];
-	char * bufferhead = (char*) &buffer;
-	bool first_update = true; //first update is forced
-
 	while (app->loop)
 	{
 		/* Flush pending Wayland events/requests. */
@@ -489,90 +742,102 @@ static void app_run (struct App *app)
 			goto exit;
 		}
 
+		fds[control_fd].fd = app->control.fd;
+		fds[control_fd].events = POLLIN;
+		fds[stats_fd].fd = app->stats.fd;
+		fds[stats_fd].events = POLLIN;
+		for (size_t c = 0; c < CONTROL_MAX_CLIENTS; c++)
+		{
+			fds[client_fds+c].fd = app->control.clients[c].fd;
+			fds[client_fds+c].events = POLLIN;
+		}
+
+		/* While nothing is rendered, timers are not polled. Inputs are
+		 * still read, so the panes hold the latest content once
+		 * rendering resumes.
+		 */
+		bool suspended = surfaces_suspended(app);
+		fds[timer_fd].fd = suspended ? -1 : app->scheduler.fd;
+
+		size_t i = pane_fds;
+		wl_list_for_each(pane, &app->panes, link)
+		{
+			fds[i].fd = suspended && pane_is_timed(pane) ? -1 : pane_get_fd(pane);
+			fds[i++].events = POLLIN;
+		}
+
 		printlog(app, 3, "Polling...\n");
-		ret = poll(fds, fd_count, !app->ready || app->require_update ? 500 : -1); //blocking once app is ready and we have text
+		TRACE_BEGIN(poll);
+		ret = poll(fds, fd_count, parked_surfaces_timeout(app));
+		TRACE_END(poll);
+		app->stats.wakeups++;
 		if ( ret < 0 )
 		{
 			printlog(NULL, 0, "ERROR: poll: %s\n", strerror(errno));
 			continue;
 		}
-		printlog(app, 3, "Polled %d, wayland=%d, stdin=%d, signal=%d, timer=%d \n",ret, fds[wayland_fd].revents, fds[stdin_fd].revents, fds[signal_fd].revents, fds[timer_fd].revents);
+
+		/* Parked surfaces hold on to their buffers until they expire,
+		 * which must happen even if nothing is updated any more.
+		 */
+		prune_parked_surfaces(app, false);
+		printlog(app, 3, "Polled %d, wayland=%d, signal=%d, timer=%d \n",ret, fds[wayland_fd].revents, fds[signal_fd].revents, fds[timer_fd].revents);
 
 		/* Wayland events */
+		TRACE_BEGIN(dispatch);
 		if ( fds[wayland_fd].revents & POLLIN && wl_display_dispatch(app->display) == -1 )
 		{
-			printlog(NULL, 0, "ERROR: wl_display_flush: %s\n", strerror(errno));
+			printlog(NULL, 0, "ERROR: wl_display_dispatch: %s\n", strerror(errno));
 			goto error;
 		}
+		TRACE_END(dispatch);
 		if ( fds[wayland_fd].revents & POLLOUT && wl_display_flush(app->display) == -1 )
 		{
 			printlog(NULL, 0, "ERROR: wl_display_flush: %s\n", strerror(errno));
 			goto error;
 		}
 
-		size_t line_size;
-		char *line = NULL;
-		bool flushbuffer = false;
-
-		if ( fds[stdin_fd].revents & POLLIN)
-		{
-			printlog(app, 2, "Processing stdin\n");
-			if ( getline(&line, &line_size, stdin) != -1 ) {
-				printlog(app, 2, "Read line (size=%d)\n", line_size);
-				if (app->feed && strcmp(app->delimiter,"") == 0) {
-					if (app->text != NULL) free(app->text);
-					app->text = strdup(line);
-					app->require_update = true;
-				} else if (app->feed && strcmp(app->delimiter, line) == 0) {
-					flushbuffer = true;
-				} else {
-					if ((bufferhead - buffer) + strlen(line) >= BUFFERSIZE) {
-						printlog(app, 2, "Buffer size exceeded.. ignoring line\n");
-					} else {
-						strncpy(bufferhead, line, strlen(line));
-						bufferhead += strlen(line);
-					}
-				}
-				if (feof(stdin)) flushbuffer = true; //not sure this can actually happen here
-			} else {
-				printlog(app, 2, "No line to get\n");
-				flushbuffer = true;
-			}
-
-		}
-
-		if ((fds[stdin_fd].revents & POLLHUP))
-		{
-			//input pipe got closed, process all remaining input
-			printlog(app, 2, "Input pipe got closed\n");
-			while ( fgets(bufferhead, BUFFERSIZE - strlen(bufferhead), stdin) ) {
-				bufferhead += strlen(bufferhead);
-			}
-			if (bufferhead != buffer) flushbuffer = true;
+		/* Pane inputs. A hang-up is only handled once read() reports
+		 * EOF, so no remaining input is lost.
+		 */
+		TRACE_BEGIN(read_panes);
+		i = pane_fds;
+		wl_list_for_each(pane, &app->panes, link)
+			if ( fds[i++].revents & (POLLIN | POLLHUP) )
+				pane_read(pane);
+		TRACE_END(read_panes);
 
-			//stop reading stdin
-			fds[stdin_fd].events = 0;
-			fds[stdin_fd].revents = 0;
-			fds[stdin_fd].fd = -1;
-		}
+		/* Control commands. */
+		TRACE_BEGIN(control);
+		for (size_t c = 0; c < CONTROL_MAX_CLIENTS; c++)
+			if ( fds[client_fds+c].revents & (POLLIN | POLLHUP) )
+				control_read(app, &app->control.clients[c]);
+		if ( fds[control_fd].revents & POLLIN )
+			control_accept(app);
+		TRACE_END(control);
 
 		if ( fds[timer_fd].revents & POLLIN)
 		{
 			printlog(app, 3, "timer tick\n");
-			uint64_t elapsed = 0;
-			read(fds[timer_fd].fd, &elapsed, sizeof(elapsed));
+			scheduler_tick(app);
+			if (has_dirty_pane(app))
+				app->require_update = true;
 		}
 
-		if ((flushbuffer) && (bufferhead != buffer)) {
-			printlog(app, 2, "Flushing buffer (size %d)\n", bufferhead - buffer);
-			if (app->text != NULL) free(app->text);
-			*bufferhead = 0;
-			app->text = strdup(buffer);
-			bufferhead = (char*) &buffer;
-			*bufferhead = 0;
+		if ( fds[timezone_fd].revents & POLLIN
+				&& timezone_dispatch(app, fds[timezone_fd].fd) )
+			wl_list_for_each(pane, &app->panes, link)
+				pane_timezone_changed(pane);
+
+		if ( fds[stats_fd].revents & POLLIN )
+		{
+			uint64_t elapsed = 0;
+			if ( read(fds[stats_fd].fd, &elapsed, sizeof(elapsed)) != sizeof(elapsed) )
+				printlog(NULL, 0, "ERROR: Can not read statistics timer: %s\n",
+						strerror(errno));
+			else
+				write_stats_file(app);
 		}
-			app->require_update = true;
-		
 
 #ifdef HANDLE_SIGNALS
 		/* Signal events. */
@@ -591,46 +856,99 @@ static void app_run (struct App *app)
 				printlog(app, 1, "[main] Received SIGINT, SIGQUIT or SIGTERM; Exiting.\n");
 				goto exit;
 			}
-			else if ( fdsi.ssi_signo == SIGUSR1 || fdsi.ssi_signo == SIGUSR2 )
+			else if ( fdsi.ssi_signo == SIGUSR1 )
 			{
-				printlog(app, 1, "[main] Received SIGUSR; Forcing update.\n");
-				update(app);
+				printlog(app, 1, "[main] Received SIGUSR1; Forcing update.\n");
+				app->require_update = true;
+			}
+			else if ( fdsi.ssi_signo == SIGUSR2 )
+			{
+				printlog(app, 1, "[main] Received SIGUSR2; Dumping statistics.\n");
+				dump_stats(app, stderr);
+				if ( app->stats.path != NULL )
+					write_stats_file(app);
 			}
-
 		}
+#endif
 
-		if ((first_update) || (fds[timer_fd].revents & POLLIN)) {
-			if (app->ready) {
-				if (app->require_update) {
-					printlog(app, 1, "Calling update.\n");
-					update(app);
-					app->require_update = false;
-					first_update = false;
-				}
-			} else {
-				printlog(app, 3, "App not ready yet.\n");
+		/* Surfaces which are not yet configured render all panes on
+		 * their first configure event anyway.
+		 */
+		if ( app->require_update && app->ready )
+		{
+			printlog(app, 1, "Calling update.\n");
+			if ( app->scheduler.overloaded && ! dispatch_wayland_events(app) )
+				goto error;
+			TRACE_BEGIN(update);
+			update(app);
+			TRACE_END(update);
+			if ( app->stats.buffers_created != buffers_measured )
+			{
+				measure_memory(app);
+				buffers_measured = app->stats.buffers_created;
 			}
+			app->require_update = false;
 		}
-#endif
 	}
 
-	return;
+	goto exit;
 error:
 	app->ret = EXIT_FAILURE;
-#ifdef HANDLE_SIGNALS
 exit:
 	if ( fds[signal_fd].fd != -1 )
 		close(fds[signal_fd].fd);
-#endif
-	if ( fds[wayland_fd].fd != -1 )
-		close(fds[wayland_fd].fd);
+	if ( fds[timezone_fd].fd != -1 )
+		close(fds[timezone_fd].fd);
+	finish_scheduler(&app->scheduler);
+	free(fds);
 	return;
 }
 
+/* Returns the time the process was started at on the monotonic clock, or 0
+ * if it is unknown. Only available on Linux, with a resolution of a clock
+ * tick.
+ */
+static uint64_t get_exec_time (uint64_t now)
+{
+	char buffer[1024];
+	int fd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+	if ( fd == -1 )
+		return 0;
+	ssize_t len = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if ( len <= 0 )
+		return 0;
+	buffer[len] = '\0';
+
+	/* The start time is the 22nd field, counting from the process
+	 * name in parentheses, which may contain spaces itself.
+	 */
+	char *field = strrchr(buffer, ')');
+	for (int i = 2; field != NULL && i < 22; i++)
+		field = strchr(field + 1, ' ');
+	unsigned long long ticks;
+	long hz = sysconf(_SC_CLK_TCK);
+	struct timespec boot;
+	if ( field == NULL || sscanf(field, " %llu", &ticks) != 1 || hz <= 0
+			|| clock_gettime(CLOCK_BOOTTIME, &boot) == -1 )
+		return 0;
+
+	uint64_t start = (uint64_t)ticks * 1000000000 / (uint64_t)hz;
+	uint64_t since_boot = (uint64_t)boot.tv_sec * 1000000000 + (uint64_t)boot.tv_nsec;
+	if ( start > since_boot || since_boot - start > now )
+		return 0;
+	return now - (since_boot - start);
+}
+
 int main (int argc, char *argv[])
 {
 	struct App app = { 0 };
+	bool ran = false;
+	app.timing.main = monotonic_ns();
+	app.timing.exec = get_exec_time(app.timing.main);
 	wl_list_init(&app.outputs);
+	wl_list_init(&app.parked_surfaces);
+	wl_list_init(&app.presentation_feedbacks);
 	app.ret = EXIT_FAILURE;
 	app.loop = true;
 	app.verbosity = 0;
@@ -641,10 +959,7 @@ int main (int argc, char *argv[])
 	app.layer = ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM;
 	app.anchor = 0; /* Center */
 	app.interval = 1000;
-	app.wordwrap = true;
-	app.center = false;
-	app.font_pattern = "Monospace 26";
-	app.delimiter = "";
+	app.control.fd = -1;
 	set_string(&app.namespace, "wayout");
 	app.border_bottom = app.border_top
 		= app.border_left = app.border_right = 0;
@@ -657,23 +972,61 @@ int main (int argc, char *argv[])
 	app.require_update = true;
 	colour_from_string(&app.background_colour, "#00000000");
 	colour_from_string(&app.border_colour,     "#000000");
-	colour_from_string(&app.text_colour,      "#ffffff");
 
-	if (! handle_command_flags(&app, argc, argv))
+	wl_list_init(&app.panes);
+	init_stats(&app.stats);
+	init_scheduler(&app.scheduler);
+	if ( create_pane(&app, NULL) == NULL )
 		goto exit;
 
+	if (! handle_command_flags(&app, argc, argv))
+		goto exit;
+	if (! start_stats_timer(&app.stats))
+		goto exit;
+	if (app.low_power)
+		enter_low_power(&app);
 
-	printlog(&app, 1, "[main] wayout: version=%s\n[main] w=%d h=%d font=%s\n",
+	printlog(&app, 1, "[main] wayout: version=%s\n[main] w=%d h=%d panes=%d\n",
 			VERSION,
-			app.dimensions.w, app.dimensions.h, app.font_pattern);
+			app.dimensions.w, app.dimensions.h, wl_list_length(&app.panes));
 
 	if (! init_wayland(&app))
 		goto exit;
 
+	struct Draw_pane *pane;
+	wl_list_for_each(pane, &app.panes, link)
+		if (! init_pane(pane))
+			goto exit;
+	app.timing.panes = monotonic_ns();
+
+	if (! init_control(&app))
+		goto exit;
+
+	ran = true;
 	app_run(&app);
 
 exit:
+	if ( app.verbosity >= 1 )
+	{
+		fputs("[main] Statistics at exit:\n", stderr);
+		dump_stats(&app, stderr);
+	}
+	else if (ran)
+	{
+		fputs("[main] Memory at exit:\n", stderr);
+		dump_memory(&app, stderr);
+	}
+#ifdef TRACING
+	if ( app.trace_path != NULL )
+		trace_export(app.trace_path);
+#endif
+	free_if_set(app.trace_path);
 	finish_wayland(&app);
+	finish_control(&app);
+	finish_stats(&app.stats);
+	if ( app.pango_context != NULL )
+		g_object_unref(app.pango_context);
+	destroy_all_panes(&app);
 	free_if_set(app.output);
 	free_if_set(app.namespace);
 	return app.ret;
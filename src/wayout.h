@@ -5,10 +5,16 @@
 #include<stdint.h>
 #include<time.h>
 #include<wayland-server.h>
+#include<pango/pangocairo.h>
 
 #include"wlr-layer-shell-unstable-v1-protocol.h"
 
 #include"colour.h"
+#include"control.h"
+#include"scheduler.h"
+#include"stats.h"
+
+struct Draw_pane;
 
 struct Draw_dimensions
 {
@@ -16,6 +22,15 @@ struct Draw_dimensions
 	int32_t w, h;
 };
 
+/* Points in time on the monotonic clock in nanoseconds, used to report
+ * where the time until the first frame went. Zero if not reached (yet).
+ */
+struct Startup_timing
+{
+	bool     enabled;
+	uint64_t exec, main, connected, globals, panes, configured, committed;
+};
+
 struct App
 {
 	struct wl_display             *display;
@@ -25,8 +40,28 @@ struct App
 	struct wl_shm                 *shm;
 	struct zwlr_layer_shell_v1    *layer_shell;
 	struct zxdg_output_manager_v1 *xdg_output_manager;
+	struct wl_seat                *seat;
+
+	/* Both are optional. Rendering is suspended while the output of a
+	 * surface is powered off or, if idle_timeout is set, while the
+	 * session is idle. The power manager is only bound if track_power is
+	 * set, as wlroots grants power control of an output to one client
+	 * only.
+	 */
+	struct zwlr_output_power_manager_v1 *output_power_manager;
+	bool track_power;
+	struct ext_idle_notifier_v1         *idle_notifier;
+	struct ext_idle_notification_v1     *idle_notification;
+	uint32_t idle_timeout;
+	bool     idle;
+
+	/* Optional, to measure when frames hit the screen. */
+	struct wp_presentation *presentation;
+	clockid_t               presentation_clock;
+	struct wl_list          presentation_feedbacks;
 
 	struct wl_list outputs;
+	struct wl_list parked_surfaces;
 	char *output;
 
 	bool loop;
@@ -43,21 +78,41 @@ struct App
 	int32_t anchor;
 	bool input, snap;
 
-	bool feed;
 	int32_t interval;
-	char *delimiter;
+	struct Scheduler scheduler;
+
+	/* Align timers to the real time clock, allow the kernel to defer
+	 * them and, on the background layer, lower the priority.
+	 */
+	bool low_power;
 
 	struct Draw_colour background_colour;
 	struct Draw_colour border_colour;
-	struct Draw_colour text_colour;
 
-	char *font_pattern;
-	char *text;
+	/* All panes of the widget and the one the pane specific command line
+	 * flags currently apply to.
+	 */
+	struct wl_list panes;
+	struct Draw_pane *pane;
+
+	/* Incremented on every content change; Used to find out which parts
+	 * of a buffer are out of date.
+	 */
+	uint64_t seq;
+
+	struct Control control;
+
+	/* Shared by the layouts of all panes on all outputs. */
+	PangoContext *pango_context;
 
 	bool require_update;
 	bool ready;
-	bool wordwrap;
-	bool center;
+
+	struct Startup_timing timing;
+	struct Stats          stats;
+
+	/* Where the trace is written at exit, if built with tracing. */
+	char *trace_path;
 };
 
 #endif
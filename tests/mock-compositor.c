@@ -0,0 +1,906 @@
+/* A minimal compositor built on libwayland-server, just enough to run
+ * wayout against: wl_compositor, wl_subcompositor, wl_shm, wl_output,
+ * zxdg_output_manager_v1 and zwlr_layer_shell_v1. Nothing is ever drawn;
+ * the compositor only tracks the committed state, so the tests can check
+ * what the client did and when, and it lets the tests add and remove
+ * outputs, change their scale and hold back buffer releases.
+ */
+#include<stdio.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/mman.h>
+
+#include<wayland-server.h>
+
+#include"xdg-output-unstable-v1-server-protocol.h"
+#include"wlr-layer-shell-unstable-v1-server-protocol.h"
+
+#include"mock-compositor.h"
+
+/* No-Op function. */
+static void noop () {}
+
+static void destroy_resource (struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+uint64_t mock_now (void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/* The compositor has no real outputs to be done with the buffers, so they
+ * are released once another buffer replaced them, either right away or
+ * after the configured delay.
+ */
+static void send_release (struct Mock_buffer *buffer)
+{
+	buffer->busy = false;
+	if ( buffer->mock->client != NULL )
+		wl_buffer_send_release(buffer->resource);
+}
+
+static int handle_release_timer (void *data)
+{
+	send_release((struct Mock_buffer *)data);
+	return 0;
+}
+
+static void release_buffer (struct Mock_buffer *buffer)
+{
+	if ( buffer == NULL || ! buffer->busy )
+		return;
+
+	struct Mock *mock = buffer->mock;
+	if ( mock->release_delay > 0 && buffer->release_timer == NULL )
+		buffer->release_timer = wl_event_loop_add_timer(mock->loop,
+				handle_release_timer, buffer);
+	if ( mock->release_delay > 0 && buffer->release_timer != NULL )
+		wl_event_source_timer_update(buffer->release_timer, mock->release_delay);
+	else
+		send_release(buffer);
+}
+
+static struct Mock_output *get_surface_output (struct Mock_surface *surface)
+{
+	if ( surface->role == MOCK_ROLE_SUBSURFACE && surface->parent != NULL )
+		return surface->parent->output;
+	return surface->output;
+}
+
+static void buffer_handle_resource_destroy (struct wl_resource *resource)
+{
+	struct Mock_buffer *buffer = wl_resource_get_user_data(resource);
+	struct Mock        *mock   = buffer->mock;
+
+	struct Mock_surface *surface;
+	wl_list_for_each(surface, &mock->surfaces, link)
+	{
+		if ( surface->buffer == buffer )
+			surface->buffer = NULL;
+		if ( surface->pending_buffer == buffer )
+			surface->pending_buffer = NULL;
+	}
+
+	if ( buffer->release_timer != NULL )
+		wl_event_source_remove(buffer->release_timer);
+	mock->buffers_live--;
+	free(buffer);
+}
+
+static const struct wl_buffer_interface buffer_implementation = {
+	.destroy = destroy_resource,
+};
+
+struct Mock_pool
+{
+	struct Mock *mock;
+	int32_t      size;
+};
+
+static void pool_handle_create_buffer (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id, int32_t offset,
+		int32_t w, int32_t h, int32_t stride, uint32_t format)
+{
+	struct Mock_pool *pool = wl_resource_get_user_data(resource);
+
+	if ( format != WL_SHM_FORMAT_ARGB8888 && format != WL_SHM_FORMAT_XRGB8888 )
+	{
+		wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_FORMAT,
+				"invalid format 0x%x", format);
+		return;
+	}
+	if ( offset < 0 || w <= 0 || h <= 0 || stride / 4 < w
+			|| (int64_t)offset + (int64_t)stride * h > pool->size )
+	{
+		wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_STRIDE,
+				"invalid buffer: offset=%d w=%d h=%d stride=%d pool=%d",
+				offset, w, h, stride, pool->size);
+		return;
+	}
+
+	struct Mock_buffer *buffer = calloc(1, sizeof(struct Mock_buffer));
+	if ( buffer == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	buffer->resource = wl_resource_create(client, &wl_buffer_interface, 1, id);
+	if ( buffer->resource == NULL )
+	{
+		free(buffer);
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	buffer->mock = pool->mock;
+	buffer->w    = w;
+	buffer->h    = h;
+	buffer->busy = false;
+	wl_resource_set_implementation(buffer->resource, &buffer_implementation,
+			buffer, buffer_handle_resource_destroy);
+
+	pool->mock->buffers_created++;
+	pool->mock->buffers_live++;
+}
+
+static void pool_handle_resize (struct wl_client *client,
+		struct wl_resource *resource, int32_t size)
+{
+	struct Mock_pool *pool = wl_resource_get_user_data(resource);
+	if ( size < pool->size )
+	{
+		wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_STRIDE,
+				"pools can not shrink");
+		return;
+	}
+	pool->size = size;
+}
+
+static void pool_handle_resource_destroy (struct wl_resource *resource)
+{
+	free(wl_resource_get_user_data(resource));
+}
+
+static const struct wl_shm_pool_interface pool_implementation = {
+	.create_buffer = pool_handle_create_buffer,
+	.destroy       = destroy_resource,
+	.resize        = pool_handle_resize,
+};
+
+static void shm_handle_create_pool (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id, int32_t fd, int32_t size)
+{
+	/* Nothing is ever drawn, but a pool the client can not map would
+	 * not work with a real compositor either.
+	 */
+	void *memory = size > 0
+		? mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0)
+		: MAP_FAILED;
+	close(fd);
+	if ( memory == MAP_FAILED )
+	{
+		wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_FD,
+				"can not map pool: size=%d", size);
+		return;
+	}
+	munmap(memory, (size_t)size);
+
+	struct Mock_pool *pool = calloc(1, sizeof(struct Mock_pool));
+	if ( pool == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	struct wl_resource *pool_resource = wl_resource_create(client,
+			&wl_shm_pool_interface, 1, id);
+	if ( pool_resource == NULL )
+	{
+		free(pool);
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	pool->mock = wl_resource_get_user_data(resource);
+	pool->size = size;
+	wl_resource_set_implementation(pool_resource, &pool_implementation,
+			pool, pool_handle_resource_destroy);
+}
+
+static const struct wl_shm_interface shm_implementation = {
+	.create_pool = shm_handle_create_pool,
+};
+
+static void bind_shm (struct wl_client *client, void *data,
+		uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource = wl_resource_create(client,
+			&wl_shm_interface, (int)version, id);
+	if ( resource == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &shm_implementation, data, NULL);
+	wl_shm_send_format(resource, WL_SHM_FORMAT_ARGB8888);
+	wl_shm_send_format(resource, WL_SHM_FORMAT_XRGB8888);
+}
+
+static void frame_handle_resource_destroy (struct wl_resource *resource)
+{
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static void surface_handle_attach (struct wl_client *client,
+		struct wl_resource *resource, struct wl_resource *buffer,
+		int32_t x, int32_t y)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	surface->pending_attach = true;
+	surface->pending_buffer = buffer != NULL ? wl_resource_get_user_data(buffer) : NULL;
+}
+
+static void surface_handle_frame (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	struct wl_resource *callback = wl_resource_create(client,
+			&wl_callback_interface, 1, id);
+	if ( callback == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(callback, NULL, NULL,
+			frame_handle_resource_destroy);
+	wl_list_insert(surface->pending_frames.prev, wl_resource_get_link(callback));
+}
+
+static void surface_handle_set_buffer_scale (struct wl_client *client,
+		struct wl_resource *resource, int32_t scale)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	if ( scale < 1 )
+	{
+		wl_resource_post_error(resource, WL_SURFACE_ERROR_INVALID_SCALE,
+				"invalid scale %d", scale);
+		return;
+	}
+	surface->pending_scale = scale;
+}
+
+static void commit_buffer (struct Mock_surface *surface)
+{
+	struct Mock        *mock   = surface->mock;
+	struct Mock_buffer *buffer = surface->pending_buffer;
+
+	surface->pending_attach = false;
+	surface->pending_buffer = NULL;
+
+	if ( buffer != surface->buffer )
+	{
+		release_buffer(surface->buffer);
+
+		/* A client must not reuse a buffer before it got released. */
+		if ( buffer != NULL && buffer->busy )
+			mock->busy_attaches++;
+	}
+	surface->buffer = buffer;
+	if ( buffer == NULL )
+		return;
+
+	buffer->busy = true;
+	if ( buffer->release_timer != NULL )
+		wl_event_source_timer_update(buffer->release_timer, 0);
+
+	struct Mock_output *output = get_surface_output(surface);
+	if ( surface->role == MOCK_ROLE_SUBSURFACE )
+	{
+		mock->text_commits++;
+		mock->text_committed_at = mock_now();
+		if ( output != NULL )
+		{
+			output->text_commits++;
+			output->text_w     = buffer->w;
+			output->text_h     = buffer->h;
+			output->text_scale = surface->scale;
+		}
+	}
+	else if ( surface->role == MOCK_ROLE_LAYER_SURFACE && output != NULL )
+	{
+		output->background_commits++;
+		output->background_w     = buffer->w;
+		output->background_h     = buffer->h;
+		output->background_scale = surface->scale;
+	}
+}
+
+static void surface_handle_commit (struct wl_client *client,
+		struct wl_resource *resource)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	struct Mock         *mock    = surface->mock;
+
+	if ( surface->role == MOCK_ROLE_LAYER_SURFACE && surface->pending_attach
+			&& surface->pending_buffer != NULL && ! surface->acked )
+	{
+		wl_resource_post_error(surface->layer_surface,
+				ZWLR_LAYER_SURFACE_V1_ERROR_INVALID_SURFACE_STATE,
+				"buffer attached before the first configure was acked");
+		return;
+	}
+
+	surface->scale = surface->pending_scale;
+
+	/* Like an idle compositor, nothing is repainted for a commit which
+	 * does not attach a buffer, so its frame callbacks wait for a later
+	 * commit which does.
+	 */
+	if ( surface->pending_attach && surface->pending_buffer != NULL )
+	{
+		wl_list_insert_list(mock->frames.prev, &surface->pending_frames);
+		wl_list_init(&surface->pending_frames);
+	}
+
+	if ( surface->pending_attach )
+		commit_buffer(surface);
+
+	/* The initial commit of a layer surface is answered with a
+	 * configure. Zero sizes mean the client asked to be stretched.
+	 */
+	if ( surface->role == MOCK_ROLE_LAYER_SURFACE && ! surface->configured )
+	{
+		surface->configured       = true;
+		surface->configure_serial = ++mock->serial;
+		zwlr_layer_surface_v1_send_configure(surface->layer_surface,
+				surface->configure_serial,
+				surface->w != 0 ? surface->w : (uint32_t)surface->output->w,
+				surface->h != 0 ? surface->h : (uint32_t)surface->output->h);
+	}
+}
+
+static void surface_handle_resource_destroy (struct wl_resource *resource)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	struct Mock         *mock    = surface->mock;
+
+	release_buffer(surface->buffer);
+
+	/* Frame callbacks outlive their surface. */
+	wl_list_insert_list(mock->frames.prev, &surface->pending_frames);
+
+	if ( surface->layer_surface != NULL )
+	{
+		wl_resource_set_user_data(surface->layer_surface, NULL);
+		mock->layer_surfaces--;
+	}
+
+	struct Mock_surface *child;
+	wl_list_for_each(child, &mock->surfaces, link)
+		if ( child->parent == surface )
+			child->parent = NULL;
+
+	wl_list_remove(&surface->link);
+	free(surface);
+}
+
+static const struct wl_surface_interface surface_implementation = {
+	.destroy              = destroy_resource,
+	.attach               = surface_handle_attach,
+	.damage               = noop,
+	.frame                = surface_handle_frame,
+	.set_opaque_region    = noop,
+	.set_input_region     = noop,
+	.commit               = surface_handle_commit,
+	.set_buffer_transform = noop,
+	.set_buffer_scale     = surface_handle_set_buffer_scale,
+	.damage_buffer        = noop,
+};
+
+static const struct wl_region_interface region_implementation = {
+	.destroy  = destroy_resource,
+	.add      = noop,
+	.subtract = noop,
+};
+
+static void compositor_handle_create_surface (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id)
+{
+	struct Mock_surface *surface = calloc(1, sizeof(struct Mock_surface));
+	if ( surface == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	surface->resource = wl_resource_create(client, &wl_surface_interface,
+			wl_resource_get_version(resource), id);
+	if ( surface->resource == NULL )
+	{
+		free(surface);
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	surface->mock          = wl_resource_get_user_data(resource);
+	surface->role          = MOCK_ROLE_NONE;
+	surface->scale         = 1;
+	surface->pending_scale = 1;
+	wl_list_init(&surface->pending_frames);
+	wl_list_insert(&surface->mock->surfaces, &surface->link);
+	wl_resource_set_implementation(surface->resource, &surface_implementation,
+			surface, surface_handle_resource_destroy);
+}
+
+static void compositor_handle_create_region (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id)
+{
+	struct wl_resource *region = wl_resource_create(client,
+			&wl_region_interface, 1, id);
+	if ( region == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(region, &region_implementation, NULL, NULL);
+}
+
+static const struct wl_compositor_interface compositor_implementation = {
+	.create_surface = compositor_handle_create_surface,
+	.create_region  = compositor_handle_create_region,
+};
+
+static void bind_compositor (struct wl_client *client, void *data,
+		uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource = wl_resource_create(client,
+			&wl_compositor_interface, (int)version, id);
+	if ( resource == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &compositor_implementation,
+			data, NULL);
+}
+
+static const struct wl_subsurface_interface subsurface_implementation = {
+	.destroy      = destroy_resource,
+	.set_position = noop,
+	.place_above  = noop,
+	.place_below  = noop,
+	.set_sync     = noop,
+	.set_desync   = noop,
+};
+
+static void subcompositor_handle_get_subsurface (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *surface_resource, struct wl_resource *parent_resource)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(surface_resource);
+	struct Mock_surface *parent  = wl_resource_get_user_data(parent_resource);
+	if ( surface->role != MOCK_ROLE_NONE || surface == parent )
+	{
+		wl_resource_post_error(resource, WL_SUBCOMPOSITOR_ERROR_BAD_SURFACE,
+				"surface already has a role");
+		return;
+	}
+
+	struct wl_resource *subsurface = wl_resource_create(client,
+			&wl_subsurface_interface, 1, id);
+	if ( subsurface == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(subsurface, &subsurface_implementation,
+			NULL, NULL);
+	surface->role   = MOCK_ROLE_SUBSURFACE;
+	surface->parent = parent;
+}
+
+static const struct wl_subcompositor_interface subcompositor_implementation = {
+	.destroy        = destroy_resource,
+	.get_subsurface = subcompositor_handle_get_subsurface,
+};
+
+static void bind_subcompositor (struct wl_client *client, void *data,
+		uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource = wl_resource_create(client,
+			&wl_subcompositor_interface, (int)version, id);
+	if ( resource == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &subcompositor_implementation,
+			data, NULL);
+}
+
+static void output_handle_resource_destroy (struct wl_resource *resource)
+{
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
+static const struct wl_output_interface output_implementation = {
+	.release = destroy_resource,
+};
+
+static void send_output_state (struct Mock_output *output,
+		struct wl_resource *resource)
+{
+	int version = wl_resource_get_version(resource);
+	if ( version >= WL_OUTPUT_SCALE_SINCE_VERSION )
+		wl_output_send_scale(resource, output->scale);
+	if ( version >= WL_OUTPUT_DONE_SINCE_VERSION )
+		wl_output_send_done(resource);
+}
+
+static void bind_output (struct wl_client *client, void *data,
+		uint32_t version, uint32_t id)
+{
+	struct Mock_output *output = (struct Mock_output *)data;
+	struct wl_resource *resource = wl_resource_create(client,
+			&wl_output_interface, (int)version, id);
+	if ( resource == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &output_implementation,
+			output, output_handle_resource_destroy);
+	wl_list_insert(&output->resources, wl_resource_get_link(resource));
+
+	wl_output_send_geometry(resource, 0, 0, 0, 0, WL_OUTPUT_SUBPIXEL_UNKNOWN,
+			"wayout", output->name, WL_OUTPUT_TRANSFORM_NORMAL);
+	wl_output_send_mode(resource,
+			WL_OUTPUT_MODE_CURRENT | WL_OUTPUT_MODE_PREFERRED,
+			output->w * output->scale, output->h * output->scale,
+			1000000 / MOCK_VBLANK_INTERVAL);
+	send_output_state(output, resource);
+}
+
+struct Mock_output *mock_add_output (struct Mock *mock, const char *name,
+		int32_t w, int32_t h, int32_t scale)
+{
+	struct Mock_output *output = calloc(1, sizeof(struct Mock_output));
+	if ( output == NULL )
+		return NULL;
+	if ( NULL == (output->name = strdup(name)) )
+	{
+		free(output);
+		return NULL;
+	}
+
+	output->mock  = mock;
+	output->w     = w;
+	output->h     = h;
+	output->scale = scale;
+	wl_list_init(&output->resources);
+
+	output->global = wl_global_create(mock->display, &wl_output_interface,
+			3, output, bind_output);
+	if ( output->global == NULL )
+	{
+		free(output->name);
+		free(output);
+		return NULL;
+	}
+
+	wl_list_insert(mock->outputs.prev, &output->link);
+	return output;
+}
+
+/* Unplugs the output. Like real compositors do, its layer surfaces are
+ * closed, and the global is only withdrawn, so that requests still in
+ * flight which refer to it do not fail. It is destroyed with the mock.
+ */
+void mock_remove_output (struct Mock_output *output)
+{
+	struct Mock *mock = output->mock;
+	struct Mock_surface *surface;
+	wl_list_for_each(surface, &mock->surfaces, link)
+		if ( surface->layer_surface != NULL && surface->output == output )
+			zwlr_layer_surface_v1_send_closed(surface->layer_surface);
+
+	output->removed = true;
+	wl_global_remove(output->global);
+}
+
+void mock_set_scale (struct Mock_output *output, int32_t scale)
+{
+	output->scale = scale;
+	struct wl_resource *resource;
+	wl_resource_for_each(resource, &output->resources)
+		send_output_state(output, resource);
+}
+
+static const struct zxdg_output_v1_interface xdg_output_implementation = {
+	.destroy = destroy_resource,
+};
+
+static void xdg_output_manager_handle_get_xdg_output (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *output_resource)
+{
+	struct Mock_output *output = wl_resource_get_user_data(output_resource);
+	int version = wl_resource_get_version(resource);
+	struct wl_resource *xdg_output = wl_resource_create(client,
+			&zxdg_output_v1_interface, version, id);
+	if ( xdg_output == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(xdg_output, &xdg_output_implementation,
+			NULL, NULL);
+
+	zxdg_output_v1_send_logical_position(xdg_output, 0, 0);
+	zxdg_output_v1_send_logical_size(xdg_output, output->w, output->h);
+	if ( version >= ZXDG_OUTPUT_V1_NAME_SINCE_VERSION )
+		zxdg_output_v1_send_name(xdg_output, output->name);
+
+	/* Since version 3, wl_output.done concludes the xdg_output events. */
+	if ( version >= 3 )
+		wl_output_send_done(output_resource);
+	else
+		zxdg_output_v1_send_done(xdg_output);
+}
+
+static const struct zxdg_output_manager_v1_interface xdg_output_manager_implementation = {
+	.destroy        = destroy_resource,
+	.get_xdg_output = xdg_output_manager_handle_get_xdg_output,
+};
+
+static void bind_xdg_output_manager (struct wl_client *client, void *data,
+		uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource = wl_resource_create(client,
+			&zxdg_output_manager_v1_interface, (int)version, id);
+	if ( resource == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &xdg_output_manager_implementation,
+			data, NULL);
+}
+
+static void layer_surface_handle_set_size (struct wl_client *client,
+		struct wl_resource *resource, uint32_t w, uint32_t h)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	if ( surface == NULL )
+		return;
+	surface->w = w;
+	surface->h = h;
+}
+
+static void layer_surface_handle_ack_configure (struct wl_client *client,
+		struct wl_resource *resource, uint32_t serial)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	if ( surface == NULL )
+		return;
+	if ( ! surface->configured || serial > surface->configure_serial )
+	{
+		wl_resource_post_error(resource,
+				ZWLR_LAYER_SURFACE_V1_ERROR_INVALID_SURFACE_STATE,
+				"acked unknown serial %u", serial);
+		return;
+	}
+	if ( serial == surface->configure_serial )
+		surface->acked = true;
+}
+
+static void layer_surface_handle_resource_destroy (struct wl_resource *resource)
+{
+	struct Mock_surface *surface = wl_resource_get_user_data(resource);
+	if ( surface == NULL )
+		return;
+	surface->mock->layer_surfaces--;
+	surface->layer_surface = NULL;
+	surface->configured    = false;
+	surface->acked         = false;
+}
+
+static const struct zwlr_layer_surface_v1_interface layer_surface_implementation = {
+	.set_size                   = layer_surface_handle_set_size,
+	.set_anchor                 = noop,
+	.set_exclusive_zone         = noop,
+	.set_margin                 = noop,
+	.set_keyboard_interactivity = noop,
+	.get_popup                  = noop,
+	.ack_configure              = layer_surface_handle_ack_configure,
+	.destroy                    = destroy_resource,
+};
+
+static void layer_shell_handle_get_layer_surface (struct wl_client *client,
+		struct wl_resource *resource, uint32_t id,
+		struct wl_resource *surface_resource, struct wl_resource *output_resource,
+		uint32_t layer, const char *namespace)
+{
+	struct Mock         *mock    = wl_resource_get_user_data(resource);
+	struct Mock_surface *surface = wl_resource_get_user_data(surface_resource);
+
+	if ( surface->role != MOCK_ROLE_NONE )
+	{
+		wl_resource_post_error(resource, ZWLR_LAYER_SHELL_V1_ERROR_ROLE,
+				"surface already has a role");
+		return;
+	}
+	if ( surface->buffer != NULL )
+	{
+		wl_resource_post_error(resource,
+				ZWLR_LAYER_SHELL_V1_ERROR_ALREADY_CONSTRUCTED,
+				"surface already has a buffer");
+		return;
+	}
+	if ( layer > ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY )
+	{
+		wl_resource_post_error(resource, ZWLR_LAYER_SHELL_V1_ERROR_INVALID_LAYER,
+				"invalid layer %u", layer);
+		return;
+	}
+
+	/* Without an output, the compositor picks one. */
+	if ( output_resource == NULL && wl_list_empty(&mock->outputs) )
+	{
+		wl_client_post_implementation_error(client, "no output to pick");
+		return;
+	}
+	struct Mock_output *output = output_resource != NULL
+		? wl_resource_get_user_data(output_resource)
+		: wl_container_of(mock->outputs.next, output, link);
+
+	surface->layer_surface = wl_resource_create(client,
+			&zwlr_layer_surface_v1_interface,
+			wl_resource_get_version(resource), id);
+	if ( surface->layer_surface == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(surface->layer_surface,
+			&layer_surface_implementation, surface,
+			layer_surface_handle_resource_destroy);
+
+	surface->role   = MOCK_ROLE_LAYER_SURFACE;
+	surface->output = output;
+	mock->layer_surfaces++;
+
+	/* A surface on an output which is already gone is closed right away. */
+	if ( output->removed )
+		zwlr_layer_surface_v1_send_closed(surface->layer_surface);
+}
+
+static const struct zwlr_layer_shell_v1_interface layer_shell_implementation = {
+	.get_layer_surface = layer_shell_handle_get_layer_surface,
+};
+
+static void bind_layer_shell (struct wl_client *client, void *data,
+		uint32_t version, uint32_t id)
+{
+	struct wl_resource *resource = wl_resource_create(client,
+			&zwlr_layer_shell_v1_interface, (int)version, id);
+	if ( resource == NULL )
+	{
+		wl_client_post_no_memory(client);
+		return;
+	}
+	wl_resource_set_implementation(resource, &layer_shell_implementation,
+			data, NULL);
+}
+
+static int handle_vblank (void *data)
+{
+	struct Mock *mock = (struct Mock *)data;
+	uint32_t time = (uint32_t)(mock_now() / 1000000);
+
+	struct wl_resource *callback, *tmp;
+	wl_resource_for_each_safe(callback, tmp, &mock->frames)
+	{
+		wl_callback_send_done(callback, time);
+		wl_resource_destroy(callback);
+	}
+
+	wl_event_source_timer_update(mock->vblank, MOCK_VBLANK_INTERVAL);
+	return 0;
+}
+
+static void handle_client_destroy (struct wl_listener *listener, void *data)
+{
+	struct Mock *mock = wl_container_of(listener, mock, client_destroy);
+	mock->client = NULL;
+}
+
+struct Mock *mock_create (void)
+{
+	struct Mock *mock = calloc(1, sizeof(struct Mock));
+	if ( mock == NULL )
+		return NULL;
+
+	wl_list_init(&mock->outputs);
+	wl_list_init(&mock->surfaces);
+	wl_list_init(&mock->frames);
+
+	if ( NULL == (mock->display = wl_display_create()) )
+	{
+		free(mock);
+		return NULL;
+	}
+	mock->loop = wl_display_get_event_loop(mock->display);
+
+	/* The globals the client needs are advertised first, like the
+	 * outputs would be in most compositors.
+	 */
+	if ( wl_global_create(mock->display, &wl_compositor_interface, 4,
+				mock, bind_compositor) == NULL
+			|| wl_global_create(mock->display, &wl_subcompositor_interface, 1,
+				mock, bind_subcompositor) == NULL
+			|| wl_global_create(mock->display, &wl_shm_interface, 1,
+				mock, bind_shm) == NULL
+			|| wl_global_create(mock->display, &zxdg_output_manager_v1_interface, 3,
+				mock, bind_xdg_output_manager) == NULL
+			|| wl_global_create(mock->display, &zwlr_layer_shell_v1_interface, 1,
+				mock, bind_layer_shell) == NULL
+			|| NULL == (mock->vblank = wl_event_loop_add_timer(mock->loop,
+				handle_vblank, mock)) )
+	{
+		wl_display_destroy(mock->display);
+		free(mock);
+		return NULL;
+	}
+	wl_event_source_timer_update(mock->vblank, MOCK_VBLANK_INTERVAL);
+
+	return mock;
+}
+
+void mock_destroy (struct Mock *mock)
+{
+	if ( mock->client != NULL )
+		wl_client_destroy(mock->client);
+
+	struct Mock_output *output, *tmp;
+	wl_list_for_each_safe(output, tmp, &mock->outputs, link)
+	{
+		wl_global_destroy(output->global);
+		wl_list_remove(&output->link);
+		free(output->name);
+		free(output);
+	}
+
+	wl_event_source_remove(mock->vblank);
+	wl_display_destroy(mock->display);
+	free(mock);
+}
+
+/* Takes over one end of a connected socket pair, the other one is handed
+ * to the client through WAYLAND_SOCKET.
+ */
+bool mock_connect (struct Mock *mock, int fd)
+{
+	if ( NULL == (mock->client = wl_client_create(mock->display, fd)) )
+		return false;
+	mock->client_destroy.notify = handle_client_destroy;
+	wl_client_add_destroy_listener(mock->client, &mock->client_destroy);
+	return true;
+}
+
+/* Waits at most timeout milliseconds for something to happen and handles
+ * it. Returns false once the client disconnected.
+ */
+bool mock_dispatch (struct Mock *mock, int timeout)
+{
+	wl_display_flush_clients(mock->display);
+	wl_event_loop_dispatch(mock->loop, timeout);
+	wl_display_flush_clients(mock->display);
+	return mock->client != NULL;
+}
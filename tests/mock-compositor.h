@@ -0,0 +1,120 @@
+#ifndef WLCLOCK_MOCK_COMPOSITOR_H
+#define WLCLOCK_MOCK_COMPOSITOR_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+#include<wayland-server.h>
+
+/* Interval of the simulated vertical blank in milliseconds, at which frame
+ * callbacks are done.
+ */
+#define MOCK_VBLANK_INTERVAL 16
+
+struct Mock;
+
+struct Mock_buffer
+{
+	struct Mock            *mock;
+	struct wl_resource     *resource;
+	struct wl_event_source *release_timer;
+	int32_t                 w, h;
+
+	/* Attached to a surface and not released yet. */
+	bool                    busy;
+};
+
+enum Mock_role
+{
+	MOCK_ROLE_NONE,
+	MOCK_ROLE_LAYER_SURFACE,
+	MOCK_ROLE_SUBSURFACE,
+};
+
+struct Mock_surface
+{
+	struct wl_list       link;
+	struct Mock         *mock;
+	struct wl_resource  *resource;
+	enum Mock_role       role;
+
+	/* Layer surfaces only. */
+	struct wl_resource  *layer_surface;
+	struct Mock_output  *output;
+	uint32_t             w, h;
+	uint32_t             configure_serial;
+	bool                 configured;
+	bool                 acked;
+
+	/* Subsurfaces only. */
+	struct Mock_surface *parent;
+
+	/* Double buffered state. */
+	bool                 pending_attach;
+	struct Mock_buffer  *pending_buffer;
+	int32_t              pending_scale;
+	struct wl_list       pending_frames;
+	struct Mock_buffer  *buffer;
+	int32_t              scale;
+};
+
+struct Mock_output
+{
+	struct wl_list      link;
+	struct Mock        *mock;
+	struct wl_global   *global;
+	struct wl_list      resources;
+	char               *name;
+	int32_t             w, h, scale;
+	bool                removed;
+
+	/* The last buffers committed to the surfaces on this output. */
+	uint64_t            background_commits;
+	int32_t             background_w, background_h, background_scale;
+	uint64_t            text_commits;
+	int32_t             text_w, text_h, text_scale;
+};
+
+struct Mock
+{
+	struct wl_display      *display;
+	struct wl_event_loop   *loop;
+	struct wl_client       *client;
+	struct wl_listener      client_destroy;
+	struct wl_event_source *vblank;
+
+	struct wl_list          outputs;
+	struct wl_list          surfaces;
+
+	/* Frame callbacks of commits which attached a buffer, done at the
+	 * next vblank.
+	 */
+	struct wl_list          frames;
+
+	/* Delay in milliseconds after which a buffer which has been replaced
+	 * by another one is released. With 0, it is released right away.
+	 */
+	int                     release_delay;
+
+	uint32_t                serial;
+
+	/* Counters checked by the tests. */
+	uint64_t                buffers_created;
+	uint64_t                buffers_live;
+	uint64_t                busy_attaches;
+	uint64_t                text_commits;
+	uint64_t                text_committed_at;
+	int                     layer_surfaces;
+};
+
+uint64_t mock_now (void);
+struct Mock *mock_create (void);
+void mock_destroy (struct Mock *mock);
+bool mock_connect (struct Mock *mock, int fd);
+bool mock_dispatch (struct Mock *mock, int timeout);
+struct Mock_output *mock_add_output (struct Mock *mock, const char *name,
+		int32_t w, int32_t h, int32_t scale);
+void mock_remove_output (struct Mock_output *output);
+void mock_set_scale (struct Mock_output *output, int32_t scale);
+
+#endif
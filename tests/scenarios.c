@@ -0,0 +1,504 @@
+/* Runs wayout against the mock compositor. Every scenario starts wayout in
+ * feed mode, writes records to its standard input and checks how long it
+ * takes until they are committed, and how many buffers it allocates along
+ * the way, while outputs come and go, change their scale or hold on to
+ * buffers.
+ */
+#include<stdio.h>
+#include<stdarg.h>
+#include<stdlib.h>
+#include<stdbool.h>
+#include<stdint.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<signal.h>
+#include<unistd.h>
+#include<sys/socket.h>
+#include<sys/types.h>
+#include<sys/wait.h>
+
+#include"mock-compositor.h"
+
+/* All times in milliseconds. */
+#define STARTUP_TIMEOUT 5000
+#define EXIT_TIMEOUT    5000
+#define LATENCY_MAX     100
+
+/* Two buffers each for the background and the text surface. */
+#define BUFFERS_MAX     4
+
+#define RECORDS          50
+#define RECORD_INTERVAL  40
+
+/* The release delay is longer than a few frames, so that both buffers of
+ * the text surface are regularly busy while records come in.
+ */
+#define RELEASE_RECORDS  20
+#define RELEASE_INTERVAL 10
+#define RELEASE_DELAY    100
+
+struct Test
+{
+	struct Mock        *mock;
+	const char         *wayout;
+	pid_t               pid;
+	int                 input;
+
+	/* What the current wait_for() waits for. */
+	struct Mock_output *output;
+	uint64_t            want;
+};
+
+static void fail (const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	fputs("ERROR: ", stderr);
+	vfprintf(stderr, fmt, args);
+	fputs("\n", stderr);
+	va_end(args);
+}
+
+static bool never (struct Test *test)
+{
+	return false;
+}
+
+static bool output_committed (struct Test *test)
+{
+	return test->output->text_commits >= test->want;
+}
+
+static bool output_scaled (struct Test *test)
+{
+	return test->output->text_scale == (int32_t)test->want
+		&& test->output->background_scale == (int32_t)test->want;
+}
+
+static bool text_committed (struct Test *test)
+{
+	return test->mock->text_commits >= test->want;
+}
+
+static bool text_committed_after (struct Test *test)
+{
+	return test->mock->text_committed_at > test->want;
+}
+
+static bool layer_surfaces (struct Test *test)
+{
+	return test->mock->layer_surfaces == (int)test->want;
+}
+
+/* Runs the compositor until done() returns true, for at most timeout
+ * milliseconds.
+ */
+static bool wait_for (struct Test *test, bool (*done)(struct Test *),
+		int timeout, const char *what)
+{
+	uint64_t deadline = mock_now() + (uint64_t)timeout * 1000000;
+	while (! done(test))
+	{
+		uint64_t now = mock_now();
+		if ( now >= deadline )
+		{
+			if ( what != NULL )
+				fail("Timed out waiting for %s.", what);
+			return false;
+		}
+		if (! mock_dispatch(test->mock, (int)((deadline - now) / 1000000) + 1))
+		{
+			fail("wayout disconnected while waiting for %s.",
+					what != NULL ? what : "time to pass");
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Lets time pass while the compositor keeps running. */
+static bool pump (struct Test *test, int ms)
+{
+	wait_for(test, never, ms, NULL);
+	return test->mock->client != NULL;
+}
+
+static bool spawn_wayout (struct Test *test)
+{
+	int sockets[2], input[2];
+	if ( socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1 )
+	{
+		fail("socketpair: %s", strerror(errno));
+		return false;
+	}
+	if ( pipe(input) == -1 )
+	{
+		fail("pipe: %s", strerror(errno));
+		close(sockets[0]);
+		close(sockets[1]);
+		return false;
+	}
+	fcntl(sockets[0], F_SETFD, FD_CLOEXEC);
+	fcntl(input[0], F_SETFD, FD_CLOEXEC);
+	fcntl(input[1], F_SETFD, FD_CLOEXEC);
+
+	if ( (test->pid = fork()) == -1 )
+	{
+		fail("fork: %s", strerror(errno));
+		close(sockets[0]);
+		close(sockets[1]);
+		close(input[0]);
+		close(input[1]);
+		return false;
+	}
+	else if ( test->pid == 0 )
+	{
+		/* wl_display_connect() takes over the socket named by
+		 * WAYLAND_SOCKET instead of connecting to a display.
+		 */
+		char fd[16];
+		snprintf(fd, sizeof(fd), "%d", sockets[1]);
+		setenv("WAYLAND_SOCKET", fd, 1);
+		dup2(input[0], STDIN_FILENO);
+
+		char *argv[] = {
+			(char *)test->wayout,
+			"--feed-line",
+			"--width", "200",
+			"--height", "40",
+			NULL,
+		};
+		execv(test->wayout, argv);
+		fail("execv: %s: %s", test->wayout, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+
+	close(sockets[1]);
+	close(input[0]);
+	test->input = input[1];
+	if (! mock_connect(test->mock, sockets[0]))
+	{
+		fail("Can not create the client.");
+		close(sockets[0]);
+		return false;
+	}
+	return true;
+}
+
+/* Returns false if wayout did not exit cleanly. */
+static bool stop_wayout (struct Test *test)
+{
+	if ( test->pid <= 0 )
+		return true;
+
+	if ( test->input != -1 )
+		close(test->input);
+	test->input = -1;
+	kill(test->pid, SIGTERM);
+
+	/* Keep the compositor running, wayout may still be talking to it. */
+	uint64_t deadline = mock_now() + (uint64_t)EXIT_TIMEOUT * 1000000;
+	while ( test->mock->client != NULL && mock_now() < deadline )
+		mock_dispatch(test->mock, 10);
+	if ( test->mock->client != NULL )
+	{
+		fail("wayout did not exit.");
+		kill(test->pid, SIGKILL);
+	}
+
+	int status;
+	if ( waitpid(test->pid, &status, 0) == -1 )
+	{
+		fail("waitpid: %s", strerror(errno));
+		return false;
+	}
+	test->pid = -1;
+
+	if ( WIFSIGNALED(status) && WTERMSIG(status) != SIGTERM )
+	{
+		fail("wayout was killed by signal %d.", WTERMSIG(status));
+		return false;
+	}
+	if ( WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS )
+	{
+		fail("wayout exited with %d.", WEXITSTATUS(status));
+		return false;
+	}
+	return true;
+}
+
+/* Starts wayout and waits for its first frame on the given output. */
+static bool start (struct Test *test, struct Mock_output *output)
+{
+	if (! spawn_wayout(test))
+		return false;
+	test->output = output;
+	test->want   = 1;
+	return wait_for(test, output_committed, STARTUP_TIMEOUT, "the first frame");
+}
+
+static bool write_record (struct Test *test, int i)
+{
+	if ( dprintf(test->input, "Record %d\n", i) < 0 )
+	{
+		fail("Can not write record %d: %s", i, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/* Writes a record and waits for the next buffer committed to a text surface.
+ * Returns the time this took in nanoseconds, or 0 on failure.
+ */
+static uint64_t send_record (struct Test *test, int i)
+{
+	test->want = test->mock->text_commits + 1;
+	uint64_t written = mock_now();
+	if (! write_record(test, i))
+		return 0;
+	if (! wait_for(test, text_committed, LATENCY_MAX, "a record to be committed"))
+		return 0;
+	return test->mock->text_committed_at - written;
+}
+
+static bool check_buffers (struct Test *test, uint64_t created, uint64_t max,
+		const char *when)
+{
+	if ( created <= max )
+		return true;
+	fail("%lu buffers created %s, expected at most %lu.",
+			(unsigned long)created, when, (unsigned long)max);
+	return false;
+}
+
+/* Records are written far enough apart that no frame is in flight, so each
+ * one has to be committed right away.
+ */
+static bool test_latency (struct Test *test)
+{
+	if (! start(test, test->output))
+		return false;
+
+	uint64_t total = 0, max = 0;
+	for (int i = 0; i < RECORDS; i++)
+	{
+		uint64_t latency = send_record(test, i);
+		if ( latency == 0 )
+			return false;
+		total += latency;
+		if ( latency > max )
+			max = latency;
+		if (! pump(test, RECORD_INTERVAL))
+			return false;
+	}
+
+	fprintf(stdout, "latency: records=%d mean=%.3fms max=%.3fms buffers=%lu\n",
+			RECORDS, (double)total / RECORDS / 1e6, (double)max / 1e6,
+			(unsigned long)test->mock->buffers_created);
+	return check_buffers(test, test->mock->buffers_created, BUFFERS_MAX, "in total");
+}
+
+/* The compositor holds on to replaced buffers for a while, so wayout runs
+ * out of free buffers. It must neither allocate more of them nor reuse a
+ * busy one, and the last record must still make it to the screen once a
+ * buffer is released.
+ */
+static bool test_release (struct Test *test)
+{
+	test->mock->release_delay = RELEASE_DELAY;
+	if (! start(test, test->output))
+		return false;
+
+	uint64_t last = 0;
+	for (int i = 0; i < RELEASE_RECORDS; i++)
+	{
+		last = mock_now();
+		if ( ! write_record(test, i) || ! pump(test, RELEASE_INTERVAL) )
+			return false;
+	}
+
+	test->want = last;
+	if (! wait_for(test, text_committed_after, RELEASE_DELAY + LATENCY_MAX,
+				"the last record to be committed"))
+		return false;
+
+	fprintf(stdout, "release: records=%d buffers=%lu\n", RELEASE_RECORDS,
+			(unsigned long)test->mock->buffers_created);
+	if ( test->mock->busy_attaches > 0 )
+	{
+		fail("%lu buffers attached before they were released.",
+				(unsigned long)test->mock->busy_attaches);
+		return false;
+	}
+	return check_buffers(test, test->mock->buffers_created, BUFFERS_MAX, "in total");
+}
+
+/* A new output scale needs a new frame with buffers of the new size. */
+static bool test_scale (struct Test *test)
+{
+	struct Mock_output *output = test->output;
+	if (! start(test, output))
+		return false;
+
+	int32_t text_w = output->text_w, text_h = output->text_h;
+	int32_t background_w = output->background_w, background_h = output->background_h;
+	uint64_t created = test->mock->buffers_created;
+
+	mock_set_scale(output, 2);
+	test->want = 2;
+	if (! wait_for(test, output_scaled, LATENCY_MAX, "a frame at scale 2"))
+		return false;
+	if ( output->text_w != 2 * text_w || output->text_h != 2 * text_h
+			|| output->background_w != 2 * background_w
+			|| output->background_h != 2 * background_h )
+	{
+		fail("Buffers at scale 2 are text=%dx%d background=%dx%d, "
+				"expected text=%dx%d background=%dx%d.",
+				output->text_w, output->text_h,
+				output->background_w, output->background_h,
+				2 * text_w, 2 * text_h, 2 * background_w, 2 * background_h);
+		return false;
+	}
+
+	for (int i = 0; i < 2; i++)
+		if ( send_record(test, i) == 0 || ! pump(test, RECORD_INTERVAL) )
+			return false;
+	if ( output->text_scale != 2 || output->text_w != 2 * text_w )
+	{
+		fail("Record committed at scale %d with width %d.",
+				output->text_scale, output->text_w);
+		return false;
+	}
+
+	fprintf(stdout, "scale: buffers=%lu\n",
+			(unsigned long)(test->mock->buffers_created - created));
+	return check_buffers(test, test->mock->buffers_created - created,
+			BUFFERS_MAX, "after the scale change");
+}
+
+/* Outputs which are plugged in later get a surface of their own, and one
+ * which comes back after being unplugged gets its old buffers back.
+ */
+static bool test_hotplug (struct Test *test)
+{
+	struct Mock *mock = test->mock;
+	struct Mock_output *first = test->output;
+	if (! start(test, first))
+		return false;
+
+	struct Mock_output *second = mock_add_output(mock, "TEST-2", 1280, 720, 1);
+	if ( second == NULL )
+	{
+		fail("Can not add an output.");
+		return false;
+	}
+	test->output = second;
+	test->want   = 1;
+	if (! wait_for(test, output_committed, STARTUP_TIMEOUT,
+				"the first frame on a new output"))
+		return false;
+	if ( mock->layer_surfaces != 2 )
+	{
+		fail("%d layer surfaces on two outputs.", mock->layer_surfaces);
+		return false;
+	}
+	if (! check_buffers(test, mock->buffers_created, 2 * BUFFERS_MAX,
+				"for two outputs"))
+		return false;
+
+	/* Records show up on all outputs. */
+	uint64_t first_commits = first->text_commits;
+	test->want = second->text_commits + 1;
+	if ( ! write_record(test, 0)
+			|| ! wait_for(test, output_committed, LATENCY_MAX,
+				"a record on the new output") )
+		return false;
+	test->output = first;
+	test->want   = first_commits + 1;
+	if (! wait_for(test, output_committed, LATENCY_MAX,
+				"a record on the first output"))
+		return false;
+
+	mock_remove_output(second);
+	test->want = 1;
+	if (! wait_for(test, layer_surfaces, LATENCY_MAX,
+				"the surface on the removed output to be destroyed"))
+		return false;
+
+	uint64_t created = mock->buffers_created;
+	struct Mock_output *again = mock_add_output(mock, "TEST-2", 1280, 720, 1);
+	if ( again == NULL )
+	{
+		fail("Can not add an output.");
+		return false;
+	}
+	test->output = again;
+	test->want   = 1;
+	if (! wait_for(test, output_committed, STARTUP_TIMEOUT,
+				"the first frame on a re-plugged output"))
+		return false;
+
+	fprintf(stdout, "hotplug: buffers=%lu replugged=%lu\n",
+			(unsigned long)mock->buffers_created,
+			(unsigned long)(mock->buffers_created - created));
+	return check_buffers(test, mock->buffers_created - created, 0,
+			"for a re-plugged output");
+}
+
+static const struct
+{
+	const char *name;
+	bool      (*run)(struct Test *);
+} scenarios[] = {
+	{ "latency", test_latency },
+	{ "release", test_release },
+	{ "scale",   test_scale   },
+	{ "hotplug", test_hotplug },
+};
+
+int main (int argc, char *argv[])
+{
+	if ( argc != 3 )
+	{
+		fprintf(stderr, "Usage: %s <wayout> <scenario>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	bool (*run)(struct Test *) = NULL;
+	for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+		if (! strcmp(argv[2], scenarios[i].name))
+			run = scenarios[i].run;
+	if ( run == NULL )
+	{
+		fail("Unknown scenario: %s", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	/* A crashed wayout must fail the test, not the harness. */
+	signal(SIGPIPE, SIG_IGN);
+
+	struct Test test = {
+		.wayout = argv[1],
+		.pid    = -1,
+		.input  = -1,
+	};
+	if ( NULL == (test.mock = mock_create()) )
+	{
+		fail("Can not create the compositor.");
+		return EXIT_FAILURE;
+	}
+	if ( NULL == (test.output = mock_add_output(test.mock, "TEST-1", 1920, 1080, 1)) )
+	{
+		fail("Can not add an output.");
+		mock_destroy(test.mock);
+		return EXIT_FAILURE;
+	}
+
+	bool ok = run(&test);
+	if (! stop_wayout(&test))
+		ok = false;
+	mock_destroy(test.mock);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}